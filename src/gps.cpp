@@ -22,37 +22,27 @@
  * THE SOFTWARE.
  */
 
-#include <queue>
-#include <iostream>
-#include <iomanip>
-#include <cmath>
+#include <iterator>
 
 #include "gps.h"
 #include "timemgr.h"
+#include "log_ring.h"
 #include <pico/sync.h>
 
-typedef enum eSentenceType
-{
-    kGPGGA,
-    kGPGLL,
-    kGPGSA,
-    kGPGSV,
-    kGPRMC,
-    kGPVTG,
-    kPGTOP,
-    kPCD,
-} eSentenceType;
-
-static std::map<std::string, eSentenceType> g_SentenceTypeMap = {
-    {"$GPGGA", kGPGGA},
-    {"$GPGLL", kGPGLL},
-    {"$GPGSA", kGPGSA},
-    {"$GPGSV", kGPGSV},
-    {"$GPRMC", kGPRMC},
-    {"$GPVTG", kGPVTG},
-    {"$PGTOP", kPGTOP},
-    {"$PCD",   kPCD  },
-};
+// Autobaud tries the UART's own rate first, then these; each is listened to for a window, or
+// until enough valid sentences or UBX frames lock it in
+constexpr uint32_t autobaudRates[]  = {9600, 115200, 38400, 57600, 19200, 4800, 230400, 460800};
+constexpr uint64_t autobaudWindowUs = 1200 * 1000; // over a second, to catch a 1 Hz burst
+constexpr uint autobaudLockScore    = 3;
+
+// How often the idle loop looks for a USB console command ("stats" dumps the parser counters)
+constexpr uint64_t consolePollUs   = 100 * 1000;
+constexpr size_t maxCommandLength  = 16;
+
+#if defined(LOG_ASYNC) && !defined(LOG_DRAIN_CORE1)
+// Bytes of queued log output written per idle pass, about one USB CDC packet
+constexpr size_t logDrainChunk = 64;
+#endif
 
 static GPS* sg_pGPS          = NULL;
 static uart_inst_t* sg_pUART = nullptr;
@@ -62,18 +52,20 @@ char GPS::sm_szBuffer[GPS_BUFSIZE];
 volatile size_t GPS::sm_iHead      = 0;
 volatile size_t GPS::sm_iNext      = 0;
 volatile size_t GPS::sm_nSentences = 0;
+volatile uint64_t GPS::sm_nLastRxUs     = 0;
+volatile uint64_t GPS::sm_nBurstStartUs = 0;
+UbxFramer GPS::sm_ubxFramer;
 
 GPS::GPS(uart_inst_t* pUART0, uart_inst_t* pUART1)
     : m_pUART0(pUART0),
       m_pUART1(pUART1),
       m_bExit(false),
-      m_bGSVInProgress(false),
-      m_nSatListTime(0),
-      m_bSendGpsData(false),
-      m_pSentenceCallBack(nullptr),
-      m_pSentenceCtx(nullptr),
-      m_pGpsDataCallback(nullptr),
-      m_pGpsDataCtx(nullptr)
+      m_bAutobaud(false),
+      m_nConsolePollUs(0),
+      m_nStatsLogUs(0),
+      m_pIdleCallback(nullptr),
+      m_pIdleCtx(nullptr),
+      m_config(pUART0, pUART1)
 {
 }
 
@@ -81,16 +73,20 @@ GPS::~GPS()
 {
 }
 
-void GPS::SetSentenceCallback(void* pCtx, sentenceCallback pCB)
+void GPS::SetIdleCallback(void* pCtx, idleCallback pCB)
 {
-    m_pSentenceCtx      = pCtx;
-    m_pSentenceCallBack = pCB;
+    m_pIdleCtx      = pCtx;
+    m_pIdleCallback = pCB;
 }
 
-void GPS::SetGpsDataCallback(void* pCtx, gpsDataCallback pCB)
+void GPS::Configure(const GpsConfig::Options& options)
 {
-    m_pGpsDataCtx      = pCtx;
-    m_pGpsDataCallback = pCB;
+    m_config.SetOptions(options);
+}
+
+void GPS::SetAutobaud(bool bEnable)
+{
+    m_bAutobaud = bEnable;
 }
 
 void GPS::Run()
@@ -106,8 +102,18 @@ void GPS::Run()
     // Now enable the UART to send interrupts - RX only
     uart_set_irqs_enabled(m_pUART0, true, false);
 
+    if (m_bAutobaud)
+    {
+        detectBaud();
+    }
+
+#if defined(LOG_ASYNC) && !defined(LOG_DRAIN_CORE1)
+    LogRing::Start(); // drained from the idle path below from here on
+#endif
+
     std::string strSentence;
-    bool bSentAntennaCommands = false;
+    uint16_t nUbxMessage = 0;
+    uint16_t nUbxLength  = 0;
     while (!m_bExit)
     {
         tight_loop_contents();
@@ -115,318 +121,208 @@ void GPS::Run()
         // Read sentence from GPS device
         if (getSentence(strSentence))
         {
-            bool bValidSentenceRead = processSentence(strSentence);
+            bool bValidSentenceRead = ProcessSentence(strSentence, time_us_64());
 
             if (nullptr != m_pUART1 && bValidSentenceRead)
             {
                 uart_puts(m_pUART1, strSentence.c_str()); // Echo to the listening port
             }
 
-            if (!bSentAntennaCommands && bValidSentenceRead)
+            if (bValidSentenceRead)
             {
-                LogInfo("Sending antenna commands\n");
-                // Write commands to enable reporting external vs internal antenna.  We wait
-                // until some data is received to ensure the GPS has finished initializing.
-                std::string strPGCMD("$PGCMD,33,1*6C\r\n"); // Enable antenna output for PA6H
-                std::string strCDCMD("$CDCMD,33,1*7C\r\n"); // Enable antenna output for PA1616S
-                uart_puts(m_pUART0, strPGCMD.c_str());
-                uart_puts(m_pUART0, strCDCMD.c_str());
-                bSentAntennaCommands = true;
+                // Configuration starts once data shows the receiver has finished initializing
+                m_config.OnValidInput();
             }
         }
-
-        if (m_bSendGpsData)
+        else if (getUbxFrame(nUbxMessage, nUbxLength))
+        {
+            ProcessUbx(nUbxMessage, m_aUbxPayload, nUbxLength, time_us_64());
+            m_config.OnValidInput();
+        }
+        else
         {
-            m_bSendGpsData = false;
-            if (NULL != m_pGpsDataCallback)
+            const uint64_t nNowUs = time_us_64();
+            if (nNowUs - sm_nLastRxUs > GPS_EPOCH_QUIET_US)
             {
-                (*m_pGpsDataCallback)(m_pGpsDataCtx, m_spGPSData);
+                EndBurst(nNowUs);
             }
-        }
-    }
-}
 
-bool GPS::processSentence(std::string strSentence)
-{
-    // Validate the string
-    if (!validateSentence(strSentence))
-    {
-        return false;
-    }
-    LogInfo("Received: " + strSentence);
-
-    if (NULL != m_pSentenceCallBack)
-    {
-        (*m_pSentenceCallBack)(m_pSentenceCtx, strSentence);
-    }
-
-    if (!m_spGPSData)
-    {
-        // Guarantee we have an object to update
-        m_spGPSData           = std::make_shared<GPSData>();
-        m_spGPSData->mSatList = m_mSatListPersistent; // restore any previous data
-    }
-
-    std::vector<std::string> vElems;
-    std::stringstream s_stream(strSentence);
-    while (s_stream.good())
-    {
-        std::string substr;
-        getline(s_stream, substr, ','); // get first string delimited by comma
-        vElems.push_back(substr);
-    }
+            // Nothing to parse, so spend the idle time on background work
+            if (NULL != m_pIdleCallback)
+            {
+                (*m_pIdleCallback)(m_pIdleCtx);
+            }
+            pollConsole();
+#if defined(GPS_STATS_INTERVAL)
+            if (time_us_64() >= m_nStatsLogUs)
+            {
+                if (m_nStatsLogUs != 0)
+                {
+                    LogStats();
+                }
+                m_nStatsLogUs = time_us_64() + GPS_STATS_INTERVAL * 1000000ULL;
+            }
+#endif
+#if defined(LOG_ASYNC) && !defined(LOG_DRAIN_CORE1)
+            LogRing::Drain(logDrainChunk);
+#endif
+        }
 
-    if (time_us_64() > m_nSatListTime + 30 * 1000 * 1000) // Nothing in 30 seconds, clear vectors
-    {
-        if (!m_spGPSData->mSatList.empty())
+        if (m_config.Service())
         {
-            LogInfo("Clearing vectors\n");
-            m_spGPSData->mSatList.clear();
-            m_spGPSData->vUsedList.clear();
+            flushRx(); // anything buffered arrived at the old baud rate
         }
     }
+}
 
-    if (vElems.size() == 0)
-    {
-        LogInfo("No elements found\n");
-        return false;
-    }
-
-    if (g_SentenceTypeMap.find(vElems[0]) == g_SentenceTypeMap.end())
-    {
-        return false;
-    }
-
-    auto type = g_SentenceTypeMap.at(vElems[0]);
+void GPS::LogStats() const
+{
+    // Logged whatever LOG_LEVEL is, as it is asked for
+    TimeMgr::Log(LOG_LEVEL_INFO,
+                 "GPS stats: lines %u valid %u bad-checksum %u malformed %u unknown %u rx-overflow %u gsv-aborted %u "
+                 "ubx %u ubx-bad-checksum %u ubx-dropped %u",
+                 (unsigned int)sm_stats.Get(GPSStats::kLines), (unsigned int)sm_stats.Get(GPSStats::kValid),
+                 (unsigned int)sm_stats.Get(GPSStats::kBadChecksum), (unsigned int)sm_stats.Get(GPSStats::kMalformed),
+                 (unsigned int)sm_stats.Get(GPSStats::kUnknownType), (unsigned int)sm_stats.Get(GPSStats::kRxOverflow),
+                 (unsigned int)sm_stats.Get(GPSStats::kGsvAborted), (unsigned int)sm_stats.Get(GPSStats::kUbxFrames),
+                 (unsigned int)sm_ubxFramer.BadChecksums(), (unsigned int)sm_ubxFramer.Dropped());
+}
 
-    if (m_bGSVInProgress && type != kGPGSV) // Did not complete
+void GPS::pollConsole()
+{
+    // Commands typed on the USB console, one per line
+    const uint64_t nNowUs = time_us_64();
+    if (nNowUs < m_nConsolePollUs)
     {
-        m_bGSVInProgress = false;
-        m_mSatListIncoming.clear();
+        return;
     }
+    m_nConsolePollUs = nNowUs + consolePollUs;
 
-    switch (type)
-    {
-    case kGPGGA: // Global Positioning System Fix Data
+    int ch;
+    while ((ch = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT)
     {
-        m_bSendGpsData = true;
-        if (!vElems[7].empty())
-        {
-            m_spGPSData->strNumSats = "Sat: " + vElems[7];
-        }
-        if (!vElems[9].empty())
+        if (ch != '\r' && ch != '\n')
         {
-            double dMeters = std::stod(vElems[9].c_str());
-            std::stringstream oss;
-            if (dMeters < 1000.0)
+            if (m_strCommand.size() < maxCommandLength)
             {
-                oss << std::fixed << std::setfill(' ') << std::setprecision(1) << dMeters << "m";
+                m_strCommand += static_cast<char>(ch);
             }
-            else
-            {
-                oss << std::setfill(' ') << std::setprecision(0) << dMeters << "m";
-            }
-            m_spGPSData->strAltitude = oss.str();
+            continue;
         }
-        break;
-    }
-    case kGPGSA: // GPS DOP and active satellites
-    {
-        m_spGPSData->vUsedList.clear();
-        m_spGPSData->strMode3D = vElems[2] + "D";
-        if (vElems[2] == "1")
+        if (m_strCommand == "stats")
         {
-            m_spGPSData->strMode3D = "";
+            LogStats();
         }
-        for (int i = 3; i < 15; ++i)
+        else if (!m_strCommand.empty())
         {
-            if (!vElems[i].empty())
-            {
-                uint satNum = atoi(vElems[i].c_str());
-                if (satNum != 0)
-                {
-                    m_spGPSData->vUsedList.push_back(satNum);
-                }
-            }
-            else
-            {
-                break;
-            }
+            LogWarn("Unknown command: %s", m_strCommand.c_str());
         }
-        break;
+        m_strCommand.clear();
     }
-    case kGPGSV: // GPS Satellites in view
+}
+
+uint32_t GPS::detectBaud()
+{
+    // Score each rate by the input that passes its checksum; garbage at the wrong rate almost never does.
+    // Nothing here touches the parser counters, so the wrong rates do not show up in them.
+    const uint32_t nStartBaud = m_config.Baud();
+    uint32_t nBestBaud        = nStartBaud;
+    uint nBestScore           = 0;
+    std::string strSentence;
+    uint16_t nUbxMessage = 0;
+    uint16_t nUbxLength  = 0;
+    for (size_t i = 0; i <= std::size(autobaudRates) && nBestScore < autobaudLockScore; i++)
     {
-        // Multipart, clear any previous data and re-gather
-        if (vElems[2] == "1")
+        const uint32_t nBaud = (i == 0) ? nStartBaud : autobaudRates[i - 1];
+        if (i != 0 && nBaud == nStartBaud)
         {
-            m_mSatListIncoming.clear();
-            m_strNumGSV      = vElems[1];
-            m_bGSVInProgress = true;
+            continue;
         }
-        int nNumSatsInGSV = std::min(4, atoi(vElems[3].c_str()) - 4 * (atoi(vElems[2].c_str()) - 1));
-        if (m_bGSVInProgress)
+        m_config.SetBaud(nBaud);
+        flushRx();
+
+        uint nScore         = 0;
+        const uint64_t nEnd = time_us_64() + autobaudWindowUs;
+        while (nScore < autobaudLockScore && time_us_64() < nEnd)
         {
-            for (int i = 4; i < 4 + 4 * nNumSatsInGSV; i += 4)
-            {
-                if (!vElems[i].empty() && !vElems[i + 1].empty() && !vElems[i + 2].empty())
-                {
-                    uint num        = atoi(vElems[i].c_str());
-                    uint el         = atoi(vElems[i + 1].c_str());
-                    uint az         = atoi(vElems[i + 2].c_str());
-                    uint rssi       = vElems[i + 3].empty() ? 0 : atoi(vElems[i + 3].c_str());
-                    uint rssiScaled = (uint)(std::sqrt((double)rssi / 99.0) * 99.0);
-                    m_mSatListIncoming.emplace(std::make_pair(num, SatInfo(num, el, az, rssiScaled)));
-                }
-            }
-            if (vElems[2] == m_strNumGSV) // Last one received
+            if (getSentence(strSentence))
             {
-                m_bGSVInProgress      = false;
-                m_nSatListTime        = time_us_64();
-                m_spGPSData->mSatList = m_mSatListIncoming;
-                m_mSatListPersistent  = m_spGPSData->mSatList; // Persist the list
+                nScore += isValidSentence(strSentence) ? 1 : 0;
             }
-        }
-        break;
-    }
-    case kGPRMC: // Recommended minimum specific GPS/Transit data
-    {
-        if (!vElems[1].empty())
-        {
-            std::string& t             = vElems[1];
-            m_spGPSData->strGPSTime    = t.substr(0, 2) + ":" + t.substr(2, 2) + ":" + t.substr(4, 2) + "Z";
-            m_spGPSData->strGPSTimeRaw = t;
-        }
-        else
-        {
-            m_spGPSData->strGPSTime    = "";
-            m_spGPSData->strGPSTimeRaw.clear();
-        }
-
-        if (!vElems[9].empty())
-        {
-            m_spGPSData->strGPSDateRaw = vElems[9];
-        }
-        else
-        {
-            m_spGPSData->strGPSDateRaw.clear();
-        }
-
-        if (vElems[2] == "A")
-        {
-            if (!vElems[3].empty() && !vElems[4].empty() && !vElems[5].empty() && !vElems[6].empty())
+            else if (getUbxFrame(nUbxMessage, nUbxLength))
             {
-                m_spGPSData->bHasPosition = true;
-                m_spGPSData->strLatitude  = convertToDegrees(vElems[3], 7) + vElems[4];
-                m_spGPSData->strLongitude = convertToDegrees(vElems[5], 8) + vElems[6];
+                nScore++; // only frames that passed their checksum are queued
             }
-            if (!vElems[7].empty())
+            else if (NULL != m_pIdleCallback)
             {
-                double dKnots = std::stod(vElems[7].c_str());
-                double dMph   = dKnots * 1.15078;
-                std::stringstream oss;
-                if (dMph < 10.0)
-                {
-                    oss << std::fixed << std::setfill(' ') << std::setprecision(1) << dMph << "mph";
-                }
-                else
-                {
-                    oss << std::setfill(' ') << std::setprecision(0) << dMph << "mph";
-                }
-                m_spGPSData->strSpeed = oss.str();
+                (*m_pIdleCallback)(m_pIdleCtx);
             }
         }
-        else
+        LogDebug("Autobaud: %u valid at %u baud", nScore, (unsigned int)nBaud);
+        if (nScore > nBestScore)
         {
-            m_spGPSData->bHasPosition = false;
+            nBestScore = nScore;
+            nBestBaud  = nBaud;
         }
-        break;
     }
-    case kPGTOP: // PA6H External antenna info
+
+    if (nBestScore == 0)
     {
-        if (vElems[2] == "2")
-        {
-            m_spGPSData->bExternalAntenna = false;
-        }
-        if (vElems[2] == "3")
-        {
-            m_spGPSData->bExternalAntenna = true;
-        }
-        break;
+        LogWarn("Autobaud: no valid input at any rate, staying at %u baud", (unsigned int)nStartBaud);
     }
-    case kPCD: // PA1616S External antenna info
+    else
     {
-        if (vElems[2] == "1")
-        {
-            m_spGPSData->bExternalAntenna = false;
-        }
-        if (vElems[2] == "2")
-        {
-            m_spGPSData->bExternalAntenna = true;
-        }
-        break;
+        LogInfo("Autobaud: locked at %u baud", (unsigned int)nBestBaud);
     }
-    default:
-        break;
-    }
-    return true;
+    m_config.SetBaud(nBestBaud);
+    flushRx();
+    return nBestBaud;
 }
 
-bool GPS::validateSentence(std::string& strSentence)
+uint64_t GPS::burstStartUs(uint64_t nNowUs)
 {
-    // Validate format and remove checksum and CRLF
-    size_t nLen = strSentence.size();
-    if (nLen < 1 || strSentence[0] != '$')
-    {
-        return false;
-    }
-    if (nLen < 6 || strSentence.substr(nLen - 2, 2) != "\r\n" || strSentence[nLen - 5] != '*')
-    {
-        return false;
-    }
-    std::string specifiedCheck  = strSentence.substr(nLen - 4, 2);
-    std::string calculatedCheck = checkSum(strSentence.substr(1, nLen - 6));
-    if (calculatedCheck != specifiedCheck)
-    {
-        return false;
-    }
-
-    strSentence = strSentence.substr(0, nLen - 5);
-
-    return true;
+    uart_set_irqs_enabled(sg_pUART, false, false);
+    const uint64_t nStartUs = sm_nBurstStartUs;
+    uart_set_irqs_enabled(sg_pUART, true, false);
+    return nStartUs;
 }
 
-std::string GPS::checkSum(const std::string& strSentence)
+void GPS::onPmtkAck(uint nCommand, uint nFlag)
 {
-    uint8_t check = 0;
-    for (const char& c : strSentence)
-    {
-        check ^= (uint8_t)c;
-    }
-    std::stringstream oss;
-    oss << std::hex << std::uppercase << std::setw(2) << std::setfill('0') << (unsigned int)check;
-    return oss.str();
+    m_config.OnPmtkAck(nCommand, nFlag);
 }
 
-std::string GPS::convertToDegrees(std::string strRaw, int width)
+void GPS::onUbxAck(uint16_t nMessage, bool bAck)
 {
-    // Convert (D)DDMM.mmmm to decimal degrees
-    double dRawAsDouble = stod(strRaw);
-    int firstdigits     = int(dRawAsDouble / 100);
-    int nexttwodigits   = dRawAsDouble - double(firstdigits * 100);
-    double converted    = double(firstdigits) + nexttwodigits / 60.0;
-    std::stringstream oss;
-    oss << std::fixed << std::setw(width) << std::setfill(' ') << std::setprecision(4) << converted;
-    return oss.str();
+    m_config.OnUbxAck(nMessage, bAck);
 }
 
 // RX interrupt handler
 void GPS::on_uart_rx()
 {
     uart_set_irqs_enabled(sg_pUART, false, false);
+    const uint64_t nNowUs = time_us_64();
+    if (nNowUs - sm_nLastRxUs > GPS_EPOCH_QUIET_US)
+    {
+        sm_nBurstStartUs = nNowUs;
+    }
+    sm_nLastRxUs = nNowUs;
     while (uart_is_readable(sg_pUART))
     {
-        char ch                 = uart_getc(sg_pUART);
+        char ch = uart_getc(sg_pUART);
+        if (sm_ubxFramer.Feed(static_cast<uint8_t>(ch)))
+        {
+            continue; // binary, kept out of the NMEA buffer
+        }
+        if ((sm_iHead + GPS_BUFSIZE - sm_iNext - 1) % GPS_BUFSIZE < 2) // no room for the byte and a terminator
+        {
+            sm_stats.Inc(GPSStats::kRxOverflow);
+            if (sm_nSentences == 0)
+            {
+                sm_iNext = sm_iHead; // one unterminated line fills the buffer, so it is noise: start again
+            }
+            continue;
+        }
         sm_szBuffer[sm_iNext++] = ch;
         sm_iNext %= GPS_BUFSIZE;
         if (ch == '\n')
@@ -458,3 +354,21 @@ bool GPS::getSentence(std::string& strSentence)
 
     return bFound;
 }
+
+void GPS::flushRx()
+{
+    uart_set_irqs_enabled(sg_pUART, false, false);
+    sm_iHead      = sm_iNext;
+    sm_nSentences = 0;
+    sm_ubxFramer.Reset();
+    uart_set_irqs_enabled(sg_pUART, true, false);
+}
+
+bool GPS::getUbxFrame(uint16_t& nMessage, uint16_t& nLength)
+{
+    uart_set_irqs_enabled(sg_pUART, false, false);
+    bool bFound = sm_ubxFramer.Pop(nMessage, m_aUbxPayload, nLength);
+    uart_set_irqs_enabled(sg_pUART, true, false);
+
+    return bFound;
+}
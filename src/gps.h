@@ -10,66 +10,20 @@
 #include <pico/stdlib.h>
 #include <hardware/uart.h>
 #include <string>
-#include <vector>
-#include <map>
 #include <memory>
 
-class SatInfo
-{
-public:
-    SatInfo(uint num = 0, uint el = 0, uint az = 0, uint rssi = 0)
-    {
-        m_num  = num;
-        m_el   = el;
-        m_az   = az;
-        m_rssi = rssi;
-    }
-    ~SatInfo()
-    {
-    }
-
-    uint m_num;
-    uint m_el;
-    uint m_az;
-    uint m_rssi;
-};
-
-typedef std::map<uint, SatInfo> SatList;
-typedef std::vector<uint> UsedList;
-
-class GPSData
-{
-public:
-    typedef std::shared_ptr<GPSData> Shared;
-
-    GPSData()
-        : bHasPosition(false),
-          bExternalAntenna(false)
-    {
-    }
-    ~GPSData() = default;
-
-    bool bHasPosition;
-    bool bExternalAntenna;
-    std::string strLatitude;
-    std::string strLongitude;
-    std::string strAltitude;
-    std::string strNumSats;
-    std::string strGPSTimeRaw; // Raw GPS time in HHMMSS format
-    std::string strGPSDateRaw; // Raw GPS date in DDMMYY format
-    std::string strGPSTime;    // Formatted GPS time string in HH:MM:SSZ format
-    std::string strMode3D;
-    std::string strSpeed;
-    SatList mSatList;
-    UsedList vUsedList;
-};
-
-typedef void (*sentenceCallback)(void* pCtx, std::string strSentence);
-typedef void (*gpsDataCallback)(void* pCtx, GPSData::Shared spGPSData);
+#include "gps_config.h"
+#include "gps_parser.h"
+#include "ubx.h"
 
 auto constexpr GPS_BUFSIZE = 4096; // Circular buffer size
 
-class GPS
+// GPS class
+//
+// The receiver on a UART: RX interrupt and buffering, configuration, autobaud and the USB
+// console, feeding what arrives to the parser it derives from.
+//
+class GPS : public GPSParser
 {
 public:
     typedef std::shared_ptr<GPS> Shared;
@@ -77,19 +31,24 @@ public:
     GPS(uart_inst_t* pUART0, uart_inst_t* pUART1 = nullptr);
     ~GPS();
 
-    void SetSentenceCallback(void* pCtx, sentenceCallback pCB);
-    void SetGpsDataCallback(void* pCtx, gpsDataCallback pCB);
+    void SetIdleCallback(void* pCtx, idleCallback pCB);
+    void Configure(const GpsConfig::Options& options);
+    void SetAutobaud(bool bEnable);
+    void LogStats() const;
     void Run();
     uart_inst_t* GetUART()
     {
         return m_pUART0;
     }
 
+protected:
+    uint64_t burstStartUs(uint64_t nNowUs) override;
+    void onPmtkAck(uint nCommand, uint nFlag) override;
+    void onUbxAck(uint16_t nMessage, bool bAck) override;
+
 private:
-    bool processSentence(std::string strSentence);
-    bool validateSentence(std::string& strSentence);
-    std::string checkSum(const std::string& strSentence);
-    std::string convertToDegrees(std::string strRaw, int width);
+    uint32_t detectBaud();
+    void pollConsole();
 
     uart_inst_t* m_pUART0;
     uart_inst_t* m_pUART1; // output echo
@@ -99,21 +58,24 @@ private:
     static volatile size_t sm_iHead;
     static volatile size_t sm_iNext;
     static volatile size_t sm_nSentences;
+    static volatile uint64_t sm_nLastRxUs;     // time of the last RX interrupt
+    static volatile uint64_t sm_nBurstStartUs; // time of the first RX interrupt after the line was quiet
     static void on_uart_rx();
     static bool getSentence(std::string& strSentence);
+    static void flushRx();
+    static UbxFramer sm_ubxFramer; // UBX frames split out of the RX stream
+    bool getUbxFrame(uint16_t& nMessage, uint16_t& nLength);
 
     // GPS object members
     bool m_bExit;
-    bool m_bGSVInProgress;
-    std::string m_strNumGSV;
-    uint64_t m_nSatListTime;
-    bool m_bSendGpsData;
-    GPSData::Shared m_spGPSData;
-    SatList m_mSatListIncoming;
-    SatList m_mSatListPersistent;
+    bool m_bAutobaud;
+    uint8_t m_aUbxPayload[UBX_MAX_PAYLOAD];
+    uint64_t m_nConsolePollUs; // next look for a USB console command
+    uint64_t m_nStatsLogUs;    // next periodic statistics line
+    std::string m_strCommand;  // USB console command being typed
+
+    idleCallback m_pIdleCallback;
+    void* m_pIdleCtx;
 
-    sentenceCallback m_pSentenceCallBack;
-    void* m_pSentenceCtx;
-    gpsDataCallback m_pGpsDataCallback;
-    void* m_pGpsDataCtx;
+    GpsConfig m_config;
 };
@@ -0,0 +1,308 @@
+/*
+ * GPS receiver configuration: sentence mask, baud rate and update rate
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#include <algorithm>
+
+#include "gps_config.h"
+#include "gps.h"
+#include "timemgr.h"
+#include "ubx.h"
+
+namespace
+{
+    constexpr uint64_t ackTimeoutUs  = 1000 * 1000; // per attempt
+    constexpr uint64_t baudTimeoutUs = 2000 * 1000; // for valid input at the new rate
+    constexpr uint maxTries          = 3;
+    constexpr uint32_t maxRateHz     = 1000;        // a 1 ms measurement period
+    constexpr uint32_t maxPmtkEvery  = 5;           // PMTK314 outputs a sentence at most every 5 fixes
+    constexpr uint32_t maxUbxEvery   = 255;         // CFG-MSG rates are one byte
+
+    // UBX-CFG messages, and the NMEA message IDs CFG-MSG addresses (class 0xF0)
+    constexpr uint16_t ubxCfgPrt  = 0x0600;
+    constexpr uint16_t ubxCfgMsg  = 0x0601;
+    constexpr uint16_t ubxCfgRate = 0x0608;
+    constexpr uint8_t nmeaGll     = 0x01;
+    constexpr uint8_t nmeaGsv     = 0x03;
+    constexpr uint8_t nmeaVtg     = 0x05;
+    constexpr uint8_t nmeaZda     = 0x08;
+
+    void put_u16(uint8_t* p, uint32_t nValue)
+    {
+        p[0] = static_cast<uint8_t>(nValue);
+        p[1] = static_cast<uint8_t>(nValue >> 8);
+    }
+
+    void put_u32(uint8_t* p, uint32_t nValue)
+    {
+        put_u16(p, nValue);
+        put_u16(p + 2, nValue >> 16);
+    }
+} // namespace
+
+GpsConfig::GpsConfig(uart_inst_t* pUART, uart_inst_t* pEchoUART)
+    : m_pUART(pUART),
+      m_pEchoUART(pEchoUART),
+      m_receiver(Receiver::Mtk),
+      m_iStep(0),
+      m_state(kWaitInput),
+      m_nTries(0),
+      m_nDeadlineUs(0),
+      m_nBaud(0),
+      m_nOldBaud(0),
+      m_bBaudChanged(false),
+      m_bAcked(false),
+      m_bNaked(false),
+      m_bInputSinceBaud(false)
+{
+    SetOptions(Options());
+}
+
+GpsConfig::~GpsConfig()
+{
+}
+
+void GpsConfig::SetOptions(const Options& options)
+{
+    // Takes effect from the first valid input, like the antenna commands always have
+    m_receiver = options.receiver;
+    m_nBaud    = options.nInitialBaud;
+    m_vSteps.clear();
+    m_iStep = 0;
+    m_state = kWaitInput;
+
+    // A period under 1 ms would be sent as 0, which leaves the rate alone instead
+    uint32_t nRateHz = options.nRateHz;
+    if (nRateHz > maxRateHz)
+    {
+        LogWarn("GPS config: %u Hz is above %u Hz, leaving the update rate alone", (unsigned int)nRateHz, (unsigned int)maxRateHz);
+        nRateHz = 0;
+    }
+    const uint32_t nEvery = std::min<uint32_t>((nRateHz > 1) ? nRateHz : 1, maxUbxEvery); // GSV and ZDA about once a second
+    if (m_receiver == Receiver::Mtk)
+    {
+        // Enable reporting external vs internal antenna, on the PA6H and PA1616S respectively
+        addPmtk("PGCMD,33,1", 0);
+        addPmtk("CDCMD,33,1", 0);
+
+        if (options.bSentenceMask)
+        {
+            // GLL, RMC, VTG, GGA, GSA, GSV, GRS, GST, 9 reserved, ZDA, MCHN: fixes between outputs.  The
+            // divider stops at 5, so above 5 Hz GSV and ZDA come more often than once a second.
+            std::string strGsv = std::to_string(std::min(nEvery, maxPmtkEvery));
+            addPmtk("PMTK314,0,1,0,1,1," + strGsv + ",0,0,0,0,0,0,0,0,0,0,0," + strGsv + ",0", 314);
+        }
+        if (options.nBaud != 0)
+        {
+            addPmtk("PMTK251," + std::to_string(options.nBaud), 0, options.nBaud);
+        }
+        if (nRateHz != 0)
+        {
+            addPmtk("PMTK220," + std::to_string(1000 / nRateHz), 220);
+        }
+    }
+    else
+    {
+        if (options.bSentenceMask)
+        {
+            const uint8_t rates[][2] = {
+                {nmeaGll, 0},
+                {nmeaVtg, 0},
+                {nmeaGsv, static_cast<uint8_t>(nEvery)},
+                {nmeaZda, static_cast<uint8_t>(nEvery)},
+            };
+            for (auto& rate : rates)
+            {
+                uint8_t payload[3] = {0xF0, rate[0], rate[1]}; // rate on the current port
+                addUbx("CFG-MSG", ubxCfgMsg, payload, sizeof(payload));
+            }
+        }
+        if (options.bUbxNav)
+        {
+            const uint16_t rates[][2] = {
+                {UBX_NAV_PVT, 1},
+                {UBX_NAV_TIMEGPS, static_cast<uint16_t>(nEvery)},
+                {UBX_NAV_SAT, static_cast<uint16_t>(nEvery)},
+            };
+            for (auto& rate : rates)
+            {
+                uint8_t payload[3] = {static_cast<uint8_t>(rate[0] >> 8), static_cast<uint8_t>(rate[0]), static_cast<uint8_t>(rate[1])};
+                addUbx("CFG-MSG", ubxCfgMsg, payload, sizeof(payload));
+            }
+        }
+        if (options.nBaud != 0)
+        {
+            uint8_t payload[20] = {};
+            payload[0]          = 1;      // UART1
+            put_u32(payload + 4, 0x08D0); // 8N1
+            put_u32(payload + 8, options.nBaud);
+            put_u16(payload + 12, 0x0003); // UBX and NMEA in
+            put_u16(payload + 14, 0x0003); // UBX and NMEA out
+            addUbx("CFG-PRT", ubxCfgPrt, payload, sizeof(payload), options.nBaud);
+        }
+        if (nRateHz != 0)
+        {
+            uint8_t payload[6] = {};
+            put_u16(payload, 1000 / nRateHz); // measurement period, ms
+            put_u16(payload + 2, 1);          // one solution per measurement
+            put_u16(payload + 4, 1);          // aligned to GPS time
+            addUbx("CFG-RATE", ubxCfgRate, payload, sizeof(payload));
+        }
+    }
+}
+
+void GpsConfig::addPmtk(const std::string& strBody, uint16_t nAck, uint32_t nBaud)
+{
+    m_vSteps.push_back({strBody.substr(0, strBody.find(',')), GPS::FormatCommand(strBody), nAck, nBaud});
+}
+
+void GpsConfig::addUbx(const std::string& strName, uint16_t nMessage, const uint8_t* pPayload, uint16_t nLength, uint32_t nBaud)
+{
+    uint8_t frame[64];
+    size_t nFrame = Ubx::Encode(nMessage, pPayload, nLength, frame, sizeof(frame));
+    m_vSteps.push_back({strName, std::string(reinterpret_cast<char*>(frame), nFrame), nMessage, nBaud});
+}
+
+bool GpsConfig::Service()
+{
+    // Returns true when the UART rate has just changed, so input buffered at the old rate should be discarded
+    const uint64_t nNowUs = time_us_64();
+    switch (m_state)
+    {
+    case kWaitAck:
+        if (m_bAcked || m_bNaked)
+        {
+            if (m_bNaked)
+            {
+                LogWarn("GPS config: %s rejected", m_vSteps[m_iStep].strName.c_str());
+            }
+            next();
+        }
+        else if (nNowUs > m_nDeadlineUs)
+        {
+            if (m_nTries < maxTries)
+            {
+                send();
+            }
+            else
+            {
+                LogWarn("GPS config: no acknowledgement for %s", m_vSteps[m_iStep].strName.c_str());
+                next();
+            }
+        }
+        break;
+    case kWaitBaud:
+        if (m_bInputSinceBaud)
+        {
+            LogInfo("GPS config: now at %u baud", (unsigned int)m_vSteps[m_iStep].nBaud);
+            next();
+        }
+        else if (nNowUs > m_nDeadlineUs)
+        {
+            LogWarn("GPS config: nothing valid at %u baud, back to %u", (unsigned int)m_vSteps[m_iStep].nBaud, (unsigned int)m_nOldBaud);
+            SetBaud(m_nOldBaud);
+            next();
+        }
+        break;
+    default:
+        break;
+    }
+
+    const bool bBaudChanged = m_bBaudChanged;
+    m_bBaudChanged          = false;
+    return bBaudChanged;
+}
+
+void GpsConfig::OnValidInput()
+{
+    if (m_state == kWaitInput)
+    {
+        m_iStep = 0;
+        if (m_vSteps.empty())
+        {
+            m_state = kDone;
+            return;
+        }
+        LogInfo("Configuring GPS receiver");
+        m_nTries = 0;
+        send();
+    }
+    else if (m_state == kWaitBaud)
+    {
+        m_bInputSinceBaud = true;
+    }
+}
+
+void GpsConfig::OnPmtkAck(uint nCommand, uint nFlag)
+{
+    // Flag 3 is success; 0 invalid, 1 unsupported, 2 valid but failed
+    if (m_state == kWaitAck && m_receiver == Receiver::Mtk && nCommand == m_vSteps[m_iStep].nAck)
+    {
+        m_bAcked = nFlag == 3;
+        m_bNaked = nFlag != 3;
+    }
+}
+
+void GpsConfig::OnUbxAck(uint16_t nMessage, bool bAck)
+{
+    if (m_state == kWaitAck && m_receiver == Receiver::Ublox && nMessage == m_vSteps[m_iStep].nAck)
+    {
+        m_bAcked = bAck;
+        m_bNaked = !bAck;
+    }
+}
+
+void GpsConfig::send()
+{
+    const Step& step = m_vSteps[m_iStep];
+    m_nTries++;
+    m_bAcked = false;
+    m_bNaked = false;
+    uart_write_blocking(m_pUART, reinterpret_cast<const uint8_t*>(step.strFrame.data()), step.strFrame.size());
+    LogDebug("GPS config: sent %s", step.strName.c_str());
+
+    if (step.nBaud != 0)
+    {
+        // Let the command leave at the old rate before following the receiver to the new one
+        uart_tx_wait_blocking(m_pUART);
+        m_nOldBaud = m_nBaud;
+        SetBaud(step.nBaud);
+        m_bInputSinceBaud = false;
+        m_state           = kWaitBaud;
+        m_nDeadlineUs     = time_us_64() + baudTimeoutUs;
+        return;
+    }
+    if (step.nAck == 0)
+    {
+        next();
+        return;
+    }
+    m_state       = kWaitAck;
+    m_nDeadlineUs = time_us_64() + ackTimeoutUs;
+}
+
+void GpsConfig::next()
+{
+    m_nTries = 0;
+    if (++m_iStep >= m_vSteps.size())
+    {
+        m_state = kDone;
+        LogInfo("GPS receiver configured");
+        return;
+    }
+    send();
+}
+
+void GpsConfig::SetBaud(uint32_t nBaud)
+{
+    m_nBaud        = nBaud;
+    m_bBaudChanged = true;
+    uart_set_baudrate(m_pUART, nBaud);
+    if (nullptr != m_pEchoUART)
+    {
+        uart_set_baudrate(m_pEchoUART, nBaud); // keep the echo from blocking the loop at the higher rate
+    }
+}
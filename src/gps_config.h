@@ -0,0 +1,96 @@
+/*
+ * GPS receiver configuration: sentence mask, baud rate and update rate
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <pico/stdlib.h>
+#include <hardware/uart.h>
+#include <string>
+#include <vector>
+
+// GpsConfig class
+//
+// Steps the receiver through its configuration one command at a time from the GPS loop, so
+// sentences keep flowing while it waits.  MTK receivers (PA6H, PA1616S) take PMTK commands
+// acknowledged by $PMTK001; u-blox receivers take UBX-CFG messages acknowledged by ACK-ACK.
+// A baud change has no dependable acknowledgement, so it is confirmed by valid input at the new
+// rate and undone if none arrives.
+//
+class GpsConfig
+{
+public:
+    enum class Receiver : uint8_t
+    {
+        Mtk,
+        Ublox,
+    };
+
+    struct Options
+    {
+        Receiver receiver     = Receiver::Mtk;
+        uint32_t nInitialBaud = 9600;  // rate the UART was set up with
+        uint32_t nBaud        = 0;     // 0 leaves the baud rate alone
+        uint32_t nRateHz      = 0;     // 0 leaves the update rate alone
+        bool bSentenceMask    = false; // output only the sentences the parser uses
+        bool bUbxNav          = false; // u-blox: also output NAV-PVT each fix, NAV-TIMEGPS and NAV-SAT about once a second
+    };
+
+    GpsConfig(uart_inst_t* pUART, uart_inst_t* pEchoUART = nullptr);
+    ~GpsConfig();
+
+    void SetOptions(const Options& options);
+    bool Service();
+    void OnValidInput();
+    void OnPmtkAck(uint nCommand, uint nFlag);
+    void OnUbxAck(uint16_t nMessage, bool bAck);
+    void SetBaud(uint32_t nBaud);
+    uint32_t Baud() const
+    {
+        return m_nBaud;
+    }
+    bool IsDone() const
+    {
+        return m_state == kDone;
+    }
+
+private:
+    struct Step
+    {
+        std::string strName;
+        std::string strFrame; // bytes to send, NMEA text or a UBX frame
+        uint16_t nAck;        // PMTK command or UBX message acknowledged, 0 if none is sent
+        uint32_t nBaud;       // switch to this rate after sending, 0 for none
+    };
+
+    enum State : uint8_t
+    {
+        kWaitInput,
+        kWaitAck,
+        kWaitBaud,
+        kDone,
+    };
+
+    void addPmtk(const std::string& strBody, uint16_t nAck, uint32_t nBaud = 0);
+    void addUbx(const std::string& strName, uint16_t nMessage, const uint8_t* pPayload, uint16_t nLength, uint32_t nBaud = 0);
+    void send();
+    void next();
+
+    uart_inst_t* m_pUART;
+    uart_inst_t* m_pEchoUART;
+    Receiver m_receiver;
+    std::vector<Step> m_vSteps;
+    size_t m_iStep;
+    State m_state;
+    uint m_nTries;
+    uint64_t m_nDeadlineUs;
+    uint32_t m_nBaud;    // current UART rate
+    uint32_t m_nOldBaud; // rate to fall back to if the receiver does not follow
+    bool m_bBaudChanged; // reported once by Service()
+    bool m_bAcked;
+    bool m_bNaked;
+    bool m_bInputSinceBaud;
+};
@@ -0,0 +1,981 @@
+/*
+ * NMEA and UBX parser
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "gps_parser.h"
+#include "timemgr.h"
+#include "ubx.h"
+
+typedef enum eSentenceType
+{
+    kGGA,
+    kGLL,
+    kGSA,
+    kGSV,
+    kRMC,
+    kVTG,
+    kZDA,
+    kPGTOP,
+    kPCD,
+    kPMTK,
+    kUnknown,
+} eSentenceType;
+
+// Up to five address characters packed eight bits each, with bit 40 marking a proprietary address
+constexpr uint64_t proprietaryAddress = 1ULL << 40;
+
+constexpr uint64_t pack_address(const char* pAddress, size_t nLen, uint64_t nFlags = 0)
+{
+    uint64_t nPacked = 0;
+    for (size_t i = 0; i < nLen && i < 5; i++)
+    {
+        nPacked = (nPacked << 8) | static_cast<uint8_t>(pAddress[i]);
+    }
+    return nPacked | nFlags;
+}
+
+constexpr uint64_t operator""_type(const char* pAddress, size_t nLen)
+{
+    return pack_address(pAddress, nLen);
+}
+
+constexpr uint64_t operator""_proprietary(const char* pAddress, size_t nLen)
+{
+    return pack_address(pAddress, nLen, proprietaryAddress);
+}
+
+static eSentenceType sentence_type(const std::string& strAddress)
+{
+    // Standard sentences are "$ttsss" and dispatch on the type alone, so any talker ($GP, $GN, $GL, $GA,
+    // $GB...) is accepted; proprietary sentences dispatch on their full address, or on the "Pmmm"
+    // manufacturer prefix when longer than five characters ($PMTK001)
+    if (strAddress.size() < 2)
+    {
+        return kUnknown;
+    }
+    const bool bProprietary = strAddress[1] == 'P';
+    if (!bProprietary && strAddress.size() != 6)
+    {
+        return kUnknown;
+    }
+    const size_t nProprietary = (strAddress.size() > 6) ? 4 : strAddress.size() - 1;
+    const uint64_t nKey       = bProprietary ? pack_address(strAddress.data() + 1, nProprietary, proprietaryAddress)
+                                             : pack_address(strAddress.data() + 3, 3);
+    switch (nKey)
+    {
+    case "GGA"_type:
+        return kGGA;
+    case "GLL"_type:
+        return kGLL;
+    case "GSA"_type:
+        return kGSA;
+    case "GSV"_type:
+        return kGSV;
+    case "RMC"_type:
+        return kRMC;
+    case "VTG"_type:
+        return kVTG;
+    case "ZDA"_type:
+        return kZDA;
+    case "PGTOP"_proprietary:
+        return kPGTOP;
+    case "PCD"_proprietary:
+        return kPCD;
+    case "PMTK"_proprietary:
+        return kPMTK;
+    default:
+        return kUnknown;
+    }
+}
+
+static int hexValue(char ch)
+{
+    if (ch >= '0' && ch <= '9')
+    {
+        return ch - '0';
+    }
+    if (ch >= 'A' && ch <= 'F')
+    {
+        return ch - 'A' + 10;
+    }
+    if (ch >= 'a' && ch <= 'f')
+    {
+        return ch - 'a' + 10;
+    }
+    return -1;
+}
+
+static_assert(GPS_MAX_SATS <= 64, "SatTable keeps its used flags in a uint64_t");
+
+GPSStats GPSParser::sm_stats;
+
+GPSParser::GPSParser()
+    : m_bGSVInProgress(false),
+      m_nSatListTime(0),
+      m_nZdaYear(0),
+      m_epochTrigger(EpochTrigger::Quiet),
+      m_bEpochPending(false),
+      m_bEpochSent(false),
+      m_nEpochStartUs(0),
+      m_pSentenceCallBack(nullptr),
+      m_pSentenceCtx(nullptr),
+      m_pGpsDataCallback(nullptr),
+      m_pGpsDataCtx(nullptr)
+{
+}
+
+GPSParser::~GPSParser()
+{
+}
+
+void GPSParser::SetSentenceCallback(void* pCtx, sentenceCallback pCB)
+{
+    m_pSentenceCtx      = pCtx;
+    m_pSentenceCallBack = pCB;
+}
+
+void GPSParser::SetGpsDataCallback(void* pCtx, gpsDataCallback pCB)
+{
+    m_pGpsDataCtx      = pCtx;
+    m_pGpsDataCallback = pCB;
+}
+
+void GPSParser::SetEpochTrigger(EpochTrigger trigger)
+{
+    m_epochTrigger = trigger;
+}
+
+void GPSParser::EndBurst(uint64_t nNowUs)
+{
+    // A burst that has gone quiet completes the epoch if nothing else did.  The next burst is a
+    // new epoch even without a newer time, as when the receiver has no time yet.
+    if (m_bEpochPending)
+    {
+        if (!m_bEpochSent)
+        {
+            completeEpoch(nNowUs);
+        }
+        m_bEpochPending = false;
+        m_bEpochSent    = false;
+    }
+}
+
+std::string GPSParser::FormatCommand(const std::string& strBody)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+    const uint8_t check           = checkSum(strBody.data(), strBody.size());
+    return "$" + strBody + "*" + hexDigits[check >> 4] + hexDigits[check & 0x0F] + "\r\n";
+}
+
+void GPSParser::beginEpoch(const std::string& strTime, uint64_t nNowUs)
+{
+    // A newer time means the previous epoch is over
+    if (!strTime.empty() && strTime != m_strEpochTime)
+    {
+        if (m_bEpochPending && !m_bEpochSent)
+        {
+            completeEpoch(nNowUs);
+        }
+        m_strEpochTime               = strTime;
+        m_spGPSData->strEpochTimeRaw = m_strEpochTime;
+        m_bEpochPending              = false;
+        m_bEpochSent                 = false;
+    }
+    if (!m_bEpochPending)
+    {
+        m_bEpochPending = true;
+        m_nEpochStartUs = burstStartUs(nNowUs);
+    }
+}
+
+void GPSParser::completeEpoch(uint64_t nNowUs)
+{
+    m_bEpochPending         = false;
+    m_bEpochSent            = true;
+    m_spGPSData->nLatencyUs = static_cast<uint32_t>(nNowUs - m_nEpochStartUs);
+    LogDebug("Epoch %s latency %uus", m_strEpochTime.c_str(), (unsigned int)m_spGPSData->nLatencyUs);
+    if (NULL != m_pGpsDataCallback)
+    {
+        (*m_pGpsDataCallback)(m_pGpsDataCtx, m_spGPSData);
+    }
+}
+
+bool GPSParser::ProcessSentence(std::string strSentence, uint64_t nNowUs)
+{
+    // Validate the string
+    if (!validateSentence(strSentence))
+    {
+        return false;
+    }
+    LogDebug("Received: %s", strSentence.c_str());
+
+    if (NULL != m_pSentenceCallBack)
+    {
+        (*m_pSentenceCallBack)(m_pSentenceCtx, strSentence);
+    }
+
+    if (!m_spGPSData)
+    {
+        // Guarantee we have an object to update
+        m_spGPSData = std::make_shared<GPSData>();
+    }
+
+    m_fields.Split(strSentence);
+    const NmeaFields& vElems = m_fields;
+
+    if (nNowUs > m_nSatListTime + 30 * 1000 * 1000) // Nothing in 30 seconds, clear vectors
+    {
+        if (!m_spGPSData->Sats().Empty())
+        {
+            LogDebug("Clearing vectors");
+            m_spGPSData->aSatTables[m_spGPSData->iSatTable].Clear();
+        }
+    }
+
+    if (vElems.Size() == 0)
+    {
+        LogWarn("No elements found");
+        return false;
+    }
+
+    auto type = sentence_type(vElems[0]);
+    if (type == kUnknown)
+    {
+        sm_stats.Inc(GPSStats::kUnknownType);
+        return false;
+    }
+
+    // Group sentences by their UTC time
+    const size_t iTimeField = (type == kGGA || type == kRMC || type == kZDA) ? 1 : (type == kGLL) ? 5 : 0;
+    beginEpoch((iTimeField != 0) ? vElems[iTimeField] : std::string(), nNowUs);
+
+    if (m_bGSVInProgress && (type != kGSV || vElems[0] != m_strGSVTalker || vElems[2] == "1")) // Did not complete
+    {
+        m_bGSVInProgress = false;
+        sm_stats.Inc(GPSStats::kGsvAborted);
+    }
+
+    switch (type)
+    {
+    case kGGA: // Global Positioning System Fix Data
+    {
+        if (!vElems[7].empty())
+        {
+            m_spGPSData->strNumSats = "Sat: " + vElems[7];
+        }
+        int32_t nAltitudeMm = 0;
+        if (vElems.Milli(9, nAltitudeMm))
+        {
+            m_spGPSData->strAltitude = formatAltitude(nAltitudeMm);
+        }
+        break;
+    }
+    case kGSA: // GPS DOP and active satellites
+    {
+        m_spGPSData->strMode3D = vElems[2] + "D";
+        if (vElems[2] == "1")
+        {
+            m_spGPSData->strMode3D = "";
+        }
+
+        // Multi-constellation receivers send one GSA per system, so only replace the systems this one covers.
+        // NMEA 4.10 names the system after the HDOP/VDOP fields; older $GNGSA leaves it to the PRN range.
+        GnssSystem system = talkerSystem(vElems[0]);
+        if (system == GnssSystem::Unknown && !vElems[18].empty())
+        {
+            static const GnssSystem systemIds[] = {GnssSystem::Unknown, GnssSystem::Gps, GnssSystem::Glonass,
+                                                   GnssSystem::Galileo, GnssSystem::BeiDou, GnssSystem::Qzss};
+            uint nSystemId = vElems.Int(18);
+            system         = nSystemId < std::size(systemIds) ? systemIds[nSystemId] : GnssSystem::Unknown;
+        }
+
+        uint aUsedKeys[12];
+        size_t nUsed      = 0;
+        uint nSystemsMask = (system == GnssSystem::Unknown) ? 0 : 1u << static_cast<uint>(system);
+        for (size_t i = 3; i < 15 && i < vElems.Size(); ++i)
+        {
+            if (!vElems[i].empty())
+            {
+                uint satNum = vElems.Int(i);
+                if (satNum != 0)
+                {
+                    GnssSystem satSystem  = (system == GnssSystem::Unknown) ? prnSystem(satNum) : system;
+                    nSystemsMask         |= 1u << static_cast<uint>(satSystem);
+                    aUsedKeys[nUsed++]    = SatInfo::Key(satSystem, satNum);
+                }
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        m_spGPSData->aSatTables[m_spGPSData->iSatTable].SetUsed(nSystemsMask, aUsedKeys, nUsed);
+        break;
+    }
+    case kGSV: // GPS Satellites in view
+    {
+        // Multipart per talker, gathered into the spare table on top of the other systems' satellites
+        GnssSystem system      = talkerSystem(vElems[0]);
+        const SatTable& oFront = m_spGPSData->aSatTables[m_spGPSData->iSatTable];
+        SatTable& oBack        = m_spGPSData->aSatTables[m_spGPSData->iSatTable ^ 1];
+        if (vElems[2] == "1")
+        {
+            oBack.CopyExcept(oFront, system);
+            m_strNumGSV      = vElems[1];
+            m_strGSVTalker   = vElems[0];
+            m_bGSVInProgress = true;
+        }
+        int nMessage      = vElems.Int(2);
+        int nSatsInView   = vElems.Int(3);
+        int nNumSatsInGSV = (nMessage >= 1 && nMessage <= 9 && nSatsInView <= 99) ? std::min(4, nSatsInView - 4 * (nMessage - 1)) : 0;
+        if (m_bGSVInProgress)
+        {
+            for (int i = 4; i < 4 + 4 * nNumSatsInGSV; i += 4)
+            {
+                if (!vElems[i].empty() && !vElems[i + 1].empty() && !vElems[i + 2].empty())
+                {
+                    uint num        = vElems.Int(i);
+                    uint el         = vElems.Int(i + 1);
+                    uint az         = vElems.Int(i + 2);
+                    uint rssi       = vElems.Int(i + 3);
+                    uint rssiScaled = (uint)(std::sqrt((double)rssi / 99.0) * 99.0);
+
+                    GnssSystem satSystem = (system == GnssSystem::Unknown) ? prnSystem(num) : system;
+                    SatInfo oSat(num, el, az, rssiScaled, satSystem);
+                    int iPrevious = oFront.Find(oSat.Key()); // keep the used flag until the next GSA
+                    oBack.Insert(oSat, iPrevious >= 0 && oFront.IsUsed(iPrevious));
+                }
+            }
+            if (vElems[2] == m_strNumGSV) // Last one received
+            {
+                m_bGSVInProgress         = false;
+                m_nSatListTime           = nNowUs;
+                m_spGPSData->iSatTable  ^= 1;
+            }
+        }
+        break;
+    }
+    case kRMC: // Recommended minimum specific GPS/Transit data
+    {
+        if (vElems[1].size() >= 6)
+        {
+            const std::string& t       = vElems[1];
+            m_spGPSData->strGPSTime    = t.substr(0, 2) + ":" + t.substr(2, 2) + ":" + t.substr(4, 2) + "Z";
+            m_spGPSData->strGPSTimeRaw = t;
+            m_spGPSData->nGPSTimeUs    = nNowUs;
+        }
+        else
+        {
+            m_spGPSData->strGPSTime    = "";
+            m_spGPSData->strGPSTimeRaw.clear();
+        }
+
+        if (!vElems[9].empty())
+        {
+            // Widen to DDMMYYYY when ZDA has told us the century
+            m_spGPSData->strGPSDateRaw = vElems[9];
+            if (m_nZdaYear != 0 && vElems[9].size() == 6 && std::to_string(m_nZdaYear % 100 + 100).substr(1) == vElems[9].substr(4, 2))
+            {
+                m_spGPSData->strGPSDateRaw = vElems[9].substr(0, 4) + std::to_string(m_nZdaYear);
+            }
+        }
+        else
+        {
+            m_spGPSData->strGPSDateRaw.clear();
+        }
+
+        if (vElems[2] == "A")
+        {
+            int32_t nLatitudeE7  = 0;
+            int32_t nLongitudeE7 = 0;
+            std::string strLat   = convertToDegrees(vElems[3], 7, nLatitudeE7);
+            std::string strLon   = convertToDegrees(vElems[5], 8, nLongitudeE7);
+            if (!strLat.empty() && !strLon.empty() && !vElems[4].empty() && !vElems[6].empty())
+            {
+                m_spGPSData->bHasPosition = true;
+                m_spGPSData->strLatitude  = strLat + vElems[4];
+                m_spGPSData->strLongitude = strLon + vElems[6];
+                m_spGPSData->nLatitudeE7  = (vElems[4] == "S") ? -nLatitudeE7 : nLatitudeE7;
+                m_spGPSData->nLongitudeE7 = (vElems[6] == "W") ? -nLongitudeE7 : nLongitudeE7;
+            }
+            int32_t nMilliKnots = 0;
+            if (vElems.Milli(7, nMilliKnots))
+            {
+                // One knot is 514.444 mm/s
+                m_spGPSData->strSpeed = formatSpeed(static_cast<int32_t>((static_cast<int64_t>(nMilliKnots) * 514444 + 500000) / 1000000));
+            }
+        }
+        else
+        {
+            m_spGPSData->bHasPosition = false;
+        }
+        break;
+    }
+    case kZDA: // Time and date, with a four digit year
+    {
+        if (vElems[1].size() >= 6 && vElems[2].size() == 2 && vElems[3].size() == 2 && vElems[4].size() == 4)
+        {
+            const std::string& t       = vElems[1];
+            m_nZdaYear                 = static_cast<uint16_t>(vElems.Int(4));
+            m_spGPSData->strGPSTime    = t.substr(0, 2) + ":" + t.substr(2, 2) + ":" + t.substr(4, 2) + "Z";
+            m_spGPSData->strGPSTimeRaw = t;
+            m_spGPSData->strGPSDateRaw = vElems[2] + vElems[3] + vElems[4];
+            m_spGPSData->nGPSTimeUs    = nNowUs;
+        }
+        break;
+    }
+    case kPMTK: // MTK command acknowledgement
+    {
+        if (vElems[0] == "$PMTK001" && vElems.Size() >= 3)
+        {
+            onPmtkAck(vElems.Int(1), vElems.Int(2));
+        }
+        break;
+    }
+    case kPGTOP: // PA6H External antenna info
+    {
+        if (vElems[2] == "2")
+        {
+            m_spGPSData->bExternalAntenna = false;
+        }
+        if (vElems[2] == "3")
+        {
+            m_spGPSData->bExternalAntenna = true;
+        }
+        break;
+    }
+    case kPCD: // PA1616S External antenna info
+    {
+        if (vElems[2] == "1")
+        {
+            m_spGPSData->bExternalAntenna = false;
+        }
+        if (vElems[2] == "2")
+        {
+            m_spGPSData->bExternalAntenna = true;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+
+    if ((m_epochTrigger == EpochTrigger::Gga && type == kGGA) || (m_epochTrigger == EpochTrigger::Rmc && type == kRMC))
+    {
+        if (!m_bEpochSent)
+        {
+            completeEpoch(nNowUs);
+        }
+    }
+    return true;
+}
+
+bool GPSParser::ProcessUbx(uint16_t nMessage, const uint8_t* pPayload, uint16_t nLength, uint64_t nNowUs)
+{
+    sm_stats.Inc(GPSStats::kUbxFrames);
+    if (!m_spGPSData)
+    {
+        // Guarantee we have an object to update
+        m_spGPSData = std::make_shared<GPSData>();
+    }
+
+    switch (nMessage)
+    {
+    case UBX_NAV_PVT: // The whole fix for the epoch in one message
+    {
+        UbxNavPvt pvt;
+        if (!Ubx::DecodeNavPvt(pPayload, nLength, pvt))
+        {
+            return false;
+        }
+        char szTime[16];
+        snprintf(szTime, sizeof(szTime), "%02u%02u%02u", pvt.hour, pvt.minute, pvt.second);
+        beginEpoch(pvt.bTimeValid ? szTime : "", nNowUs);
+        LogDebug("Received: UBX NAV-PVT %s fix %u", szTime, pvt.fixType);
+
+        if (pvt.bTimeValid)
+        {
+            std::string t              = szTime;
+            m_spGPSData->strGPSTime    = t.substr(0, 2) + ":" + t.substr(2, 2) + ":" + t.substr(4, 2) + "Z";
+            m_spGPSData->strGPSTimeRaw = t;
+            m_spGPSData->nGPSTimeUs    = nNowUs;
+        }
+        else
+        {
+            m_spGPSData->strGPSTime = "";
+            m_spGPSData->strGPSTimeRaw.clear();
+        }
+        if (pvt.bDateValid)
+        {
+            char szDate[16];
+            snprintf(szDate, sizeof(szDate), "%02u%02u%04u", pvt.day, pvt.month, pvt.year);
+            m_spGPSData->strGPSDateRaw = szDate;
+        }
+        else
+        {
+            m_spGPSData->strGPSDateRaw.clear();
+        }
+
+        m_spGPSData->strNumSats = "Sat: " + std::to_string(pvt.numSV);
+        m_spGPSData->strMode3D  = (pvt.fixType == 3 || pvt.fixType == 4) ? "3D" : (pvt.fixType == 2) ? "2D" : "";
+        if (pvt.bFixOk && pvt.fixType >= 2 && pvt.fixType <= 4)
+        {
+            m_spGPSData->bHasPosition = true;
+            m_spGPSData->nLatitudeE7  = pvt.latE7;
+            m_spGPSData->nLongitudeE7 = pvt.lonE7;
+            m_spGPSData->strLatitude  = formatDegrees(pvt.latE7, 7) + (pvt.latE7 < 0 ? "S" : "N");
+            m_spGPSData->strLongitude = formatDegrees(pvt.lonE7, 8) + (pvt.lonE7 < 0 ? "W" : "E");
+            m_spGPSData->strAltitude  = formatAltitude(pvt.hMslMm);
+            m_spGPSData->strSpeed     = formatSpeed(pvt.gSpeedMm);
+        }
+        else
+        {
+            m_spGPSData->bHasPosition = false;
+        }
+        break;
+    }
+    case UBX_NAV_TIMEGPS: // Only the leap seconds; NAV-PVT carries the UTC time
+    {
+        UbxNavTimeGps timeGps;
+        if (!Ubx::DecodeNavTimeGps(pPayload, nLength, timeGps))
+        {
+            return false;
+        }
+        beginEpoch("", nNowUs);
+        LogDebug("Received: UBX NAV-TIMEGPS week %d leap %d%s", timeGps.week, timeGps.leapS, timeGps.bLeapSValid ? "" : " (default)");
+        if (timeGps.bLeapSValid)
+        {
+            m_spGPSData->nLeapSeconds      = timeGps.leapS;
+            m_spGPSData->bLeapSecondsValid = true;
+        }
+        break;
+    }
+    case UBX_NAV_SAT: // Every satellite of every system, so it replaces the whole table
+    {
+        UbxSat aSats[GPS_MAX_SATS];
+        size_t nSats = Ubx::DecodeNavSat(pPayload, nLength, aSats, GPS_MAX_SATS);
+        beginEpoch("", nNowUs);
+        LogDebug("Received: UBX NAV-SAT %u satellites", (unsigned int)nSats);
+
+        SatTable& oBack = m_spGPSData->aSatTables[m_spGPSData->iSatTable ^ 1];
+        oBack.Clear();
+        for (size_t i = 0; i < nSats; i++)
+        {
+            // Numbered as NMEA would: SBAS 33-64 and GLONASS 65-96 alongside GPS
+            static const GnssSystem systems[] = {GnssSystem::Gps, GnssSystem::Gps, GnssSystem::Galileo, GnssSystem::BeiDou,
+                                                 GnssSystem::Unknown, GnssSystem::Qzss, GnssSystem::Glonass};
+            const UbxSat& sat = aSats[i];
+            if (sat.gnssId >= std::size(systems) || systems[sat.gnssId] == GnssSystem::Unknown || (sat.gnssId == 1 && sat.svId < 120) ||
+                sat.elev < 0 || sat.azim < 0)
+            {
+                continue;
+            }
+            uint num        = (sat.gnssId == 1) ? sat.svId - 87 : (sat.gnssId == 6) ? sat.svId + 64 : sat.svId;
+            uint rssiScaled = (uint)(std::sqrt((double)sat.cno / 99.0) * 99.0);
+            oBack.Insert(SatInfo(num, sat.elev, sat.azim, rssiScaled, systems[sat.gnssId]), sat.bUsed);
+        }
+        m_bGSVInProgress        = false;
+        m_nSatListTime          = nNowUs;
+        m_spGPSData->iSatTable ^= 1;
+        break;
+    }
+    case UBX_ACK_ACK:
+    case UBX_ACK_NAK:
+    {
+        if (nLength >= 2)
+        {
+            onUbxAck(static_cast<uint16_t>((pPayload[0] << 8) | pPayload[1]), nMessage == UBX_ACK_ACK);
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+    return true;
+}
+
+bool GPSParser::validateSentence(std::string& strSentence)
+{
+    // Validate format and remove checksum and CRLF
+    sm_stats.Inc(GPSStats::kLines);
+    const GPSStats::Counter result = checkSentence(strSentence);
+    sm_stats.Inc(result);
+    if (result != GPSStats::kValid)
+    {
+        return false;
+    }
+
+    strSentence.resize(strSentence.size() - 5); // shortening keeps the buffer
+    return true;
+}
+
+bool GPSParser::isValidSentence(const std::string& strSentence)
+{
+    return checkSentence(strSentence) == GPSStats::kValid;
+}
+
+GPSStats::Counter GPSParser::checkSentence(const std::string& strSentence)
+{
+    // "$...*hh\r\n" with a matching checksum is kValid, otherwise the counter for what is wrong
+    size_t nLen = strSentence.size();
+    if (nLen < 1 || strSentence[0] != '$')
+    {
+        return GPSStats::kMalformed;
+    }
+    if (nLen < 6 || strSentence[nLen - 2] != '\r' || strSentence[nLen - 1] != '\n' || strSentence[nLen - 5] != '*')
+    {
+        return GPSStats::kMalformed;
+    }
+    const int nHigh = hexValue(strSentence[nLen - 4]);
+    const int nLow  = hexValue(strSentence[nLen - 3]);
+    if (nHigh < 0 || nLow < 0)
+    {
+        return GPSStats::kMalformed;
+    }
+    if (checkSum(strSentence.data() + 1, nLen - 6) != ((nHigh << 4) | nLow))
+    {
+        return GPSStats::kBadChecksum;
+    }
+    return GPSStats::kValid;
+}
+
+uint8_t GPSParser::checkSum(const char* pData, size_t nLen)
+{
+    // XOR a word at a time, then fold the word's four bytes together; memcpy keeps the loads legal
+    // on the Cortex-M0+, which faults on unaligned words
+    uint32_t nWord = 0;
+    size_t i       = 0;
+    for (; i + 4 <= nLen; i += 4)
+    {
+        uint32_t nNext;
+        std::memcpy(&nNext, pData + i, sizeof(nNext));
+        nWord ^= nNext;
+    }
+    nWord ^= nWord >> 16;
+    nWord ^= nWord >> 8;
+    uint8_t check = static_cast<uint8_t>(nWord);
+    for (; i < nLen; i++)
+    {
+        check ^= static_cast<uint8_t>(pData[i]);
+    }
+    return check;
+}
+
+const std::string NmeaFields::sm_strEmpty;
+
+void NmeaFields::Split(const std::string& strSentence)
+{
+    m_nFields     = 0;
+    size_t iStart = 0;
+    while (true)
+    {
+        size_t iComma = strSentence.find(',', iStart);
+        size_t nLen   = (iComma == std::string::npos) ? strSentence.size() - iStart : iComma - iStart;
+        if (m_nFields == m_vFields.size())
+        {
+            m_vFields.emplace_back();
+        }
+        m_vFields[m_nFields++].assign(strSentence, iStart, nLen);
+        if (iComma == std::string::npos)
+        {
+            break;
+        }
+        iStart = iComma + 1;
+    }
+}
+
+int NmeaFields::Int(size_t i, int nDefault) const
+{
+    // Leading digits as strtol reads them, "12.5" giving 12; nothing numeric gives the default
+    const std::string& strField = (*this)[i];
+    char* pEnd                  = nullptr;
+    long nValue                 = std::strtol(strField.c_str(), &pEnd, 10);
+    if (pEnd == strField.c_str() || nValue > INT32_MAX || nValue < INT32_MIN)
+    {
+        return nDefault;
+    }
+    return static_cast<int>(nValue);
+}
+
+bool NmeaFields::Milli(size_t i, int32_t& nMilli) const
+{
+    // A decimal field in thousandths, read as integers; the whole field must be the number
+    const std::string& strField = (*this)[i];
+    size_t iChar                = (!strField.empty() && strField[0] == '-') ? 1 : 0;
+    const size_t iDigits        = iChar;
+    int64_t nValue              = 0;
+    for (; iChar < strField.size() && strField[iChar] >= '0' && strField[iChar] <= '9'; iChar++)
+    {
+        nValue = nValue * 10 + (strField[iChar] - '0');
+        if (nValue > INT32_MAX / 1000)
+        {
+            return false;
+        }
+    }
+    bool bDigits = iChar > iDigits;
+    nValue *= 1000;
+    if (iChar < strField.size() && strField[iChar] == '.')
+    {
+        int32_t nScale = 100;
+        for (iChar++; iChar < strField.size() && strField[iChar] >= '0' && strField[iChar] <= '9'; iChar++)
+        {
+            nValue += (strField[iChar] - '0') * nScale; // digits past the third add nothing
+            nScale /= 10;
+            bDigits = true;
+        }
+    }
+    if (!bDigits || iChar != strField.size())
+    {
+        return false;
+    }
+    nMilli = static_cast<int32_t>(strField[0] == '-' ? -nValue : nValue);
+    return true;
+}
+
+int SatTable::Find(uint nKey) const
+{
+    size_t iLow  = 0;
+    size_t iHigh = m_nCount;
+    while (iLow < iHigh)
+    {
+        size_t iMid = (iLow + iHigh) / 2;
+        uint nMid   = m_aSats[iMid].Key();
+        if (nMid == nKey)
+        {
+            return static_cast<int>(iMid);
+        }
+        if (nMid < nKey)
+        {
+            iLow = iMid + 1;
+        }
+        else
+        {
+            iHigh = iMid;
+        }
+    }
+    return -1;
+}
+
+bool SatTable::Insert(const SatInfo& oSat, bool bUsed)
+{
+    // Sentences arrive in PRN order, so this is nearly always an append
+    const uint nKey = oSat.Key();
+    size_t iPos     = m_nCount;
+    while (iPos > 0 && m_aSats[iPos - 1].Key() > nKey)
+    {
+        iPos--;
+    }
+    if ((iPos > 0 && m_aSats[iPos - 1].Key() == nKey) || m_nCount == GPS_MAX_SATS)
+    {
+        return false;
+    }
+    for (size_t i = m_nCount; i > iPos; i--)
+    {
+        m_aSats[i] = m_aSats[i - 1];
+    }
+    m_aSats[iPos] = oSat;
+    m_nCount++;
+
+    const uint64_t nBelow = (1ULL << iPos) - 1;
+    m_nUsedMask           = (m_nUsedMask & nBelow) | ((m_nUsedMask & ~nBelow) << 1) | (uint64_t(bUsed) << iPos);
+    return true;
+}
+
+void SatTable::CopyExcept(const SatTable& other, GnssSystem system)
+{
+    // GnssSystem::Unknown ($GN talker) replaces every system
+    Clear();
+    if (system == GnssSystem::Unknown)
+    {
+        return;
+    }
+    for (size_t i = 0; i < other.m_nCount; i++)
+    {
+        if (other.m_aSats[i].m_system != system)
+        {
+            m_aSats[m_nCount] = other.m_aSats[i];
+            m_nUsedMask      |= uint64_t(other.IsUsed(i)) << m_nCount;
+            m_nCount++;
+        }
+    }
+}
+
+void SatTable::SetUsed(uint nSystemsMask, const uint* pKeys, size_t nKeys)
+{
+    for (size_t i = 0; i < m_nCount; i++)
+    {
+        if ((nSystemsMask & (1u << static_cast<uint>(m_aSats[i].m_system))) != 0)
+        {
+            m_nUsedMask &= ~(1ULL << i);
+        }
+    }
+    for (size_t i = 0; i < nKeys; i++)
+    {
+        int iSat = Find(pKeys[i]);
+        if (iSat >= 0)
+        {
+            m_nUsedMask |= 1ULL << iSat;
+        }
+    }
+}
+
+GnssSystem GPSParser::talkerSystem(const std::string& strAddress)
+{
+    // $GN (combined) and unrecognised talkers leave the system to the caller
+    if (strAddress.size() < 3)
+    {
+        return GnssSystem::Unknown;
+    }
+    switch ((static_cast<uint8_t>(strAddress[1]) << 8) | static_cast<uint8_t>(strAddress[2]))
+    {
+    case ('G' << 8) | 'P':
+        return GnssSystem::Gps;
+    case ('G' << 8) | 'L':
+        return GnssSystem::Glonass;
+    case ('G' << 8) | 'A':
+        return GnssSystem::Galileo;
+    case ('G' << 8) | 'B':
+    case ('B' << 8) | 'D':
+        return GnssSystem::BeiDou;
+    case ('G' << 8) | 'Q':
+    case ('Q' << 8) | 'Z':
+        return GnssSystem::Qzss;
+    default:
+        return GnssSystem::Unknown;
+    }
+}
+
+GnssSystem GPSParser::prnSystem(uint num)
+{
+    // NMEA 4.0 extended numbering, as used in $GNGSA/$GNGSV without a system ID
+    if (num <= 64)
+    {
+        return GnssSystem::Gps; // includes SBAS
+    }
+    if (num <= 96)
+    {
+        return GnssSystem::Glonass;
+    }
+    if (num >= 193 && num <= 202)
+    {
+        return GnssSystem::Qzss;
+    }
+    if (num >= 301 && num <= 336)
+    {
+        return GnssSystem::Galileo;
+    }
+    if (num >= 401 && num <= 463)
+    {
+        return GnssSystem::BeiDou;
+    }
+    return GnssSystem::Unknown;
+}
+
+bool GPSParser::parseDegrees(const std::string& strRaw, int32_t& nDegE7)
+{
+    // (D)DDMM.mmmmmm as integers: whole degrees and minutes, then minutes in millionths
+    size_t i        = 0;
+    uint32_t nWhole = 0;
+    for (; i < strRaw.size() && strRaw[i] >= '0' && strRaw[i] <= '9'; i++)
+    {
+        nWhole = nWhole * 10 + (strRaw[i] - '0');
+    }
+    if (i < 3 || i > 5)
+    {
+        return false;
+    }
+
+    uint32_t nMinutesE6 = (nWhole % 100) * 1000000;
+    if (i < strRaw.size() && strRaw[i] == '.')
+    {
+        uint32_t nScale = 100000;
+        for (i++; i < strRaw.size() && strRaw[i] >= '0' && strRaw[i] <= '9'; i++)
+        {
+            nMinutesE6 += (strRaw[i] - '0') * nScale; // digits past the sixth add nothing
+            nScale /= 10;
+        }
+    }
+    if (i != strRaw.size() || nMinutesE6 >= 60000000 || nWhole / 100 > 180)
+    {
+        return false;
+    }
+
+    // One millionth of a minute is 1/6 of 1e-7 degree, rounded
+    nDegE7 = static_cast<int32_t>((nWhole / 100) * 10000000 + (nMinutesE6 + 3) / 6);
+    return true;
+}
+
+std::string GPSParser::formatDegrees(int32_t nDegE7, int width)
+{
+    // Magnitude to four decimals, right aligned in width, without going through a double
+    uint32_t nAbs = (nDegE7 < 0) ? static_cast<uint32_t>(-static_cast<int64_t>(nDegE7)) : static_cast<uint32_t>(nDegE7);
+    uint32_t nE4  = (nAbs + 500) / 1000;
+    char szBuf[16];
+    char* p = szBuf + sizeof(szBuf);
+    for (int nDigit = 0; nDigit < 4; nDigit++)
+    {
+        *--p = static_cast<char>('0' + nE4 % 10);
+        nE4 /= 10;
+    }
+    *--p = '.';
+    do
+    {
+        *--p = static_cast<char>('0' + nE4 % 10);
+        nE4 /= 10;
+    } while (nE4 != 0);
+
+    const int nLen = static_cast<int>(szBuf + sizeof(szBuf) - p);
+    std::string strOut(nLen < width ? width - nLen : 0, ' ');
+    strOut.append(p, nLen);
+    return strOut;
+}
+
+std::string GPSParser::formatTenths(int32_t nTenths, bool bWhole, const char* szUnit)
+{
+    // Tenths to one decimal, or rounded to a whole number, then the unit
+    uint32_t nAbs = (nTenths < 0) ? static_cast<uint32_t>(-static_cast<int64_t>(nTenths)) : static_cast<uint32_t>(nTenths);
+    char szBuf[24];
+    if (bWhole)
+    {
+        snprintf(szBuf, sizeof(szBuf), "%s%lu%s", nTenths < 0 ? "-" : "", (unsigned long)((nAbs + 5) / 10), szUnit);
+    }
+    else
+    {
+        snprintf(szBuf, sizeof(szBuf), "%s%lu.%lu%s", nTenths < 0 ? "-" : "", (unsigned long)(nAbs / 10), (unsigned long)(nAbs % 10), szUnit);
+    }
+    return szBuf;
+}
+
+std::string GPSParser::formatAltitude(int32_t nMillimeters)
+{
+    const int32_t nTenths = static_cast<int32_t>((static_cast<int64_t>(nMillimeters) + (nMillimeters < 0 ? -50 : 50)) / 100);
+    return formatTenths(nTenths, nTenths >= 10000, "m"); // whole meters from 1000m
+}
+
+std::string GPSParser::formatSpeed(int32_t nMmPerSec)
+{
+    // One mm/s is 0.002236936 mph
+    const int64_t nScaled = static_cast<int64_t>(nMmPerSec) * 2236936;
+    const int32_t nTenths = static_cast<int32_t>((nScaled + (nScaled < 0 ? -50000000 : 50000000)) / 100000000);
+    return formatTenths(nTenths, nTenths >= 100, "mph"); // whole mph from 10mph
+}
+
+std::string GPSParser::convertToDegrees(const std::string& strRaw, int width, int32_t& nDegE7)
+{
+    if (!parseDegrees(strRaw, nDegE7))
+    {
+        return "";
+    }
+    return formatDegrees(nDegE7, width);
+}
@@ -0,0 +1,331 @@
+/*
+ * NMEA and UBX parser
+ *
+ * (c) 2026 Erik Tkal
+ *
+ * Notes:
+ *   1) Everything from a received line or UBX frame to the GPSData handed to the callback,
+ *      without the Pico SDK: the UART, its interrupt and the receiver configuration stay in GPS,
+ *      so the parser also builds on a host for tests and fuzzing.
+ *   2) Times are passed in by the caller, in time_us_64() microseconds on the target.
+ */
+
+#pragma once
+
+#include <sys/types.h> // uint, as the Pico SDK defines it
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+// Satellite constellation, from the NMEA talker ID, the NMEA 4.10 system ID or the PRN range
+enum class GnssSystem : uint8_t
+{
+    Gps,
+    Glonass,
+    Galileo,
+    BeiDou,
+    Qzss,
+    Unknown,
+};
+
+auto constexpr GPS_MAX_SATS = 64; // Satellites in view tracked across all systems, at most 64 for the used bitmask
+
+class SatInfo
+{
+public:
+    SatInfo(uint num = 0, uint el = 0, uint az = 0, uint rssi = 0, GnssSystem system = GnssSystem::Gps)
+    {
+        m_num    = num;
+        m_el     = el;
+        m_az     = az;
+        m_rssi   = rssi;
+        m_system = system;
+    }
+    ~SatInfo()
+    {
+    }
+
+    // PRNs repeat between systems, so satellites are keyed by both
+    static uint Key(GnssSystem system, uint num)
+    {
+        return (static_cast<uint>(system) << 16) | num;
+    }
+    static GnssSystem KeySystem(uint nKey)
+    {
+        return static_cast<GnssSystem>(nKey >> 16);
+    }
+    uint Key() const
+    {
+        return Key(m_system, m_num);
+    }
+
+    uint m_num;
+    uint m_el;
+    uint m_az;
+    uint m_rssi;
+    GnssSystem m_system;
+};
+
+// SatTable class
+//
+// Satellites in view in a fixed array kept sorted by SatInfo::Key(), with one bit per entry
+// marking the satellites used in the fix.  Nothing allocates, and a GSV cycle is gathered
+// into a second table that then replaces the first by flipping an index.
+//
+class SatTable
+{
+public:
+    SatTable()
+        : m_nCount(0),
+          m_nUsedMask(0)
+    {
+    }
+
+    size_t Size() const
+    {
+        return m_nCount;
+    }
+    bool Empty() const
+    {
+        return m_nCount == 0;
+    }
+    const SatInfo& operator[](size_t i) const
+    {
+        return m_aSats[i];
+    }
+    bool IsUsed(size_t i) const
+    {
+        return ((m_nUsedMask >> i) & 1) != 0;
+    }
+    void Clear()
+    {
+        m_nCount    = 0;
+        m_nUsedMask = 0;
+    }
+
+    int Find(uint nKey) const;
+    bool Insert(const SatInfo& oSat, bool bUsed);
+    void CopyExcept(const SatTable& other, GnssSystem system);
+    void SetUsed(uint nSystemsMask, const uint* pKeys, size_t nKeys);
+
+private:
+    SatInfo m_aSats[GPS_MAX_SATS];
+    size_t m_nCount;
+    uint64_t m_nUsedMask; // bit i set when m_aSats[i] is used in the fix
+};
+
+class GPSData
+{
+public:
+    typedef std::shared_ptr<GPSData> Shared;
+
+    GPSData()
+        : bHasPosition(false),
+          bExternalAntenna(false),
+          nLatitudeE7(0),
+          nLongitudeE7(0),
+          nGPSTimeUs(0),
+          nLatencyUs(0),
+          nLeapSeconds(0),
+          bLeapSecondsValid(false),
+          iSatTable(0)
+    {
+    }
+    ~GPSData() = default;
+
+    const SatTable& Sats() const
+    {
+        return aSatTables[iSatTable];
+    }
+
+    bool bHasPosition;
+    bool bExternalAntenna;
+    std::string strLatitude;
+    std::string strLongitude;
+    int32_t nLatitudeE7;  // degrees * 1e7, north positive
+    int32_t nLongitudeE7; // degrees * 1e7, east positive
+    std::string strAltitude;
+    std::string strNumSats;
+    std::string strGPSTimeRaw; // Raw GPS time in HHMMSS format
+    std::string strGPSDateRaw; // Raw GPS date in DDMMYY format, or DDMMYYYY when known from ZDA
+    std::string strGPSTime;    // Formatted GPS time string in HH:MM:SSZ format
+    uint64_t nGPSTimeUs;       // time_us_64() when the RMC carrying strGPSTimeRaw was parsed
+    std::string strMode3D;
+    std::string strSpeed;
+    std::string strEpochTimeRaw; // UTC time shared by the sentences of this fix, empty before the receiver has time
+    uint32_t nLatencyUs;         // first byte of the epoch to the GPS data callback
+    int8_t nLeapSeconds;         // GPS-UTC from UBX NAV-TIMEGPS
+    bool bLeapSecondsValid;      // nLeapSeconds is from the almanac
+    SatTable aSatTables[2]; // current and being gathered
+    uint8_t iSatTable;      // index of the current table
+};
+
+// GPSStats class
+//
+// Parser health counters.  Each counter has a single writer, the RX interrupt or the GPS loop,
+// so Inc() is a relaxed load and store rather than a read-modify-write: the Cortex-M0+ has no
+// LDREX/STREX, and fetch_add would be a libcall that masks interrupts, in the ISR too.  Readers
+// only want a consistent value per counter, not across them.
+//
+class GPSStats
+{
+public:
+    enum Counter : uint8_t
+    {
+        kLines,       // lines taken from the RX buffer
+        kValid,       // lines that passed validation
+        kBadChecksum, // well formed, checksum mismatch
+        kMalformed,   // no '$', no "*hh\r\n" trailer or too short
+        kUnknownType, // valid, but an address the parser does not handle
+        kRxOverflow,  // bytes dropped with the RX buffer full
+        kGsvAborted,  // GSV cycles interrupted before their last sentence
+        kUbxFrames,   // UBX frames that passed their checksum
+        kCount,
+    };
+
+    GPSStats()
+    {
+        for (auto& count : m_aCounts)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    void Inc(Counter counter)
+    {
+        m_aCounts[counter].store(m_aCounts[counter].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    uint32_t Get(Counter counter) const
+    {
+        return m_aCounts[counter].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint32_t> m_aCounts[kCount];
+};
+
+// NmeaFields class
+//
+// The comma separated fields of a validated sentence.  A field past the end reads as empty and
+// numbers parse without exceptions, so a truncated sentence that still carries a good checksum
+// cannot read beyond what it has.  Split() reuses the field strings from one sentence to the next.
+//
+class NmeaFields
+{
+public:
+    NmeaFields()
+        : m_nFields(0)
+    {
+    }
+
+    void Split(const std::string& strSentence);
+    size_t Size() const
+    {
+        return m_nFields;
+    }
+    const std::string& operator[](size_t i) const
+    {
+        return (i < m_nFields) ? m_vFields[i] : sm_strEmpty;
+    }
+    int Int(size_t i, int nDefault = 0) const;
+    bool Milli(size_t i, int32_t& nMilli) const;
+
+private:
+    std::vector<std::string> m_vFields; // grows to the most fields seen, entries past m_nFields are stale
+    size_t m_nFields;
+    static const std::string sm_strEmpty;
+};
+
+typedef void (*sentenceCallback)(void* pCtx, std::string strSentence);
+typedef void (*gpsDataCallback)(void* pCtx, GPSData::Shared spGPSData);
+typedef void (*idleCallback)(void* pCtx);
+
+// No RX for this long ends the receiver's burst of sentences for the second
+auto constexpr GPS_EPOCH_QUIET_US = 50 * 1000;
+
+// What completes an epoch and hands its fix to the GPS data callback.  In every mode a sentence
+// carrying a newer UTC time first completes the previous epoch if it is still pending.
+enum class EpochTrigger : uint8_t
+{
+    Quiet, // the receiver goes quiet after its burst of sentences
+    Gga,   // the epoch's GGA, for receivers that send it last
+    Rmc,   // the epoch's RMC, for receivers that send it last
+};
+
+// GPSParser class
+//
+// Validates NMEA sentences and decodes them, and UBX frames, into one GPSData per epoch.  GPS
+// feeds it from the UART; the receiver's command acknowledgements come back through the
+// virtual hooks.
+//
+class GPSParser
+{
+public:
+    GPSParser();
+    virtual ~GPSParser();
+
+    void SetSentenceCallback(void* pCtx, sentenceCallback pCB);
+    void SetGpsDataCallback(void* pCtx, gpsDataCallback pCB);
+    void SetEpochTrigger(EpochTrigger trigger);
+    static std::string FormatCommand(const std::string& strBody);
+    static const GPSStats& Stats()
+    {
+        return sm_stats;
+    }
+
+    bool ProcessSentence(std::string strSentence, uint64_t nNowUs);
+    bool ProcessUbx(uint16_t nMessage, const uint8_t* pPayload, uint16_t nLength, uint64_t nNowUs);
+    void EndBurst(uint64_t nNowUs); // the receiver has gone quiet for GPS_EPOCH_QUIET_US
+
+protected:
+    bool validateSentence(std::string& strSentence);
+    static bool isValidSentence(const std::string& strSentence); // as validateSentence, but counts nothing
+    static uint8_t checkSum(const char* pData, size_t nLen);
+
+    // When the burst carrying the current input started, for the epoch latency
+    virtual uint64_t burstStartUs(uint64_t nNowUs)
+    {
+        return nNowUs;
+    }
+    virtual void onPmtkAck(uint nCommand, uint nFlag)
+    {
+    }
+    virtual void onUbxAck(uint16_t nMessage, bool bAck)
+    {
+    }
+
+    static GPSStats sm_stats;
+
+private:
+    static GPSStats::Counter checkSentence(const std::string& strSentence);
+    std::string convertToDegrees(const std::string& strRaw, int width, int32_t& nDegE7);
+    static bool parseDegrees(const std::string& strRaw, int32_t& nDegE7);
+    static std::string formatDegrees(int32_t nDegE7, int width);
+    static std::string formatTenths(int32_t nTenths, bool bWhole, const char* szUnit);
+    static std::string formatAltitude(int32_t nMillimeters);
+    static std::string formatSpeed(int32_t nMmPerSec);
+    void beginEpoch(const std::string& strTime, uint64_t nNowUs);
+    void completeEpoch(uint64_t nNowUs);
+    static GnssSystem talkerSystem(const std::string& strAddress);
+    static GnssSystem prnSystem(uint num);
+
+    bool m_bGSVInProgress;
+    std::string m_strNumGSV;
+    std::string m_strGSVTalker;
+    uint64_t m_nSatListTime;
+    uint16_t m_nZdaYear; // last four digit year seen in ZDA, 0 if none
+    EpochTrigger m_epochTrigger;
+    std::string m_strEpochTime; // UTC time of the epoch being assembled
+    bool m_bEpochPending;       // sentences applied since the last callback
+    bool m_bEpochSent;          // this UTC epoch has already gone to the callback
+    uint64_t m_nEpochStartUs;   // first byte of the epoch being assembled
+    GPSData::Shared m_spGPSData;
+    NmeaFields m_fields;
+
+    sentenceCallback m_pSentenceCallBack;
+    void* m_pSentenceCtx;
+    gpsDataCallback m_pGpsDataCallback;
+    void* m_pGpsDataCtx;
+};
@@ -57,7 +57,30 @@ static uint32_t getFreeHeap()
 namespace
 {
     constexpr uint64_t timeSyncRetryIntervalSec = 5 * 60;
+    constexpr uint64_t lowPowerAfterSec         = 60; // unchanged fix before dropping to idle/partial mode
+    constexpr uint8_t lowPowerBacklightPercent  = 20;
+    constexpr int32_t fixResolutionE7           = 1000; // 1e-4 degree, the last decimal shown
     constexpr double pi                         = 3.14159265359;
+
+    // Outline colour distinguishing each constellation in the grid and bar graph
+    uint16_t systemColour(GnssSystem system)
+    {
+        switch (system)
+        {
+        case GnssSystem::Gps:
+            return COLOUR_WHITE;
+        case GnssSystem::Glonass:
+            return COLOUR_YELLOW;
+        case GnssSystem::Galileo:
+            return COLOUR_AQUA;
+        case GnssSystem::BeiDou:
+            return COLOUR_FUCHSIA;
+        case GnssSystem::Qzss:
+            return COLOUR_LIME;
+        default:
+            return COLOUR_SILVER;
+        }
+    }
 } // namespace
 
 GPS_TFT::GPS_TFT(ILI_TFT::Shared spDisplay, GPS::Shared spGPS, LED::Shared spLED, TimeMgr::Shared spTimeMgr)
@@ -65,7 +88,13 @@ GPS_TFT::GPS_TFT(ILI_TFT::Shared spDisplay, GPS::Shared spGPS, LED::Shared spLED
       m_spGPS(spGPS),
       m_spLED(spLED),
       m_spTimeMgr(spTimeMgr),
-      m_nLastTimeSyncAttemptSec(std::numeric_limits<uint64_t>::max())
+      m_nLastTimeSyncAttemptSec(std::numeric_limits<uint64_t>::max()),
+      m_nLastGpsTimeUs(0),
+      m_bLastHasPosition(false),
+      m_nLastLatitude(0),
+      m_nLastLongitude(0),
+      m_nLastFixChangeUs(0),
+      m_bLowPower(false)
 {
 }
 
@@ -93,8 +122,18 @@ void GPS_TFT::Initialize()
     drawText(0, "Waiting for GPS", COLOUR_WHITE, false, 0);
     m_spDisplay->Show();
 
+#if defined(DISPLAY_NMEA_CONSOLE)
+    // Show raw sentences instead of the dashboard if the rotation allows hardware scrolling
+    m_spConsole = std::make_shared<ScrollConsole>(m_spDisplay);
+    if (!m_spConsole->Begin(COLOUR_BLACK))
+    {
+        m_spConsole.reset();
+    }
+#endif
+
     m_spGPS->SetSentenceCallback(this, sentenceCB);
     m_spGPS->SetGpsDataCallback(this, gpsDataCB);
+    m_spGPS->SetIdleCallback(this, idleCB);
 }
 
 void GPS_TFT::Run()
@@ -104,16 +143,28 @@ void GPS_TFT::Run()
 
 void GPS_TFT::sentenceCB(void* pCtx, std::string strSentence)
 {
-    // LogInfo("sentenceCB received: " + strSentence);
+    // LogDebug("sentenceCB received: %s", strSentence.c_str());
+    GPS_TFT* pThis = reinterpret_cast<GPS_TFT*>(pCtx);
+    if (pThis->m_spConsole)
+    {
+        pThis->m_spConsole->AddLine(strSentence, COLOUR_LIME);
+    }
 }
 
 void GPS_TFT::gpsDataCB(void* pCtx, GPSData::Shared spGPSData)
 {
     GPS_TFT* pThis = reinterpret_cast<GPS_TFT*>(pCtx);
-    pThis->updateUI(spGPSData);
+    pThis->UpdateUI(spGPSData);
+}
+
+void GPS_TFT::idleCB(void* pCtx)
+{
+    GPS_TFT* pThis = reinterpret_cast<GPS_TFT*>(pCtx);
+    pThis->m_spTimeMgr->PollNtp(); // no-op unless built with TIMEMGR_ENABLE_NTP
+    pThis->m_spTimeMgr->ServiceHoldover();
 }
 
-void GPS_TFT::updateUI(GPSData::Shared spGPSData)
+void GPS_TFT::UpdateUI(GPSData::Shared spGPSData)
 {
     m_spGPSData = spGPSData;
     if (m_spLED)
@@ -129,28 +180,57 @@ void GPS_TFT::updateUI(GPSData::Shared spGPSData)
         m_spLED->Blink_ms(20);
     }
 
+    if (m_spGPSData->bLeapSecondsValid)
+    {
+        m_spTimeMgr->SetLeapSeconds(m_spGPSData->nLeapSeconds);
+    }
+
     // Update the time if necessary
     if (!m_spGPSData->strGPSTimeRaw.empty() && !m_spGPSData->strGPSDateRaw.empty())
     {
+        m_spTimeMgr->NoteGpsTime(m_spGPSData->nGPSTimeUs); // holds the clock over when this stops
         const uint64_t uptimeSec = time_us_64() / 1000000;
         const bool bNeverRetried = (m_nLastTimeSyncAttemptSec == std::numeric_limits<uint64_t>::max());
-        const bool bRetryDue     = !TimeMgr::IsWallClockValid() || bNeverRetried ||
+        // GPS time back after a holdover resyncs at once rather than at the next retry
+        const bool bHeldOver     = m_spTimeMgr->InHoldover() && m_spTimeMgr->Source() == TimeMgr::TimeSource::Gps;
+        const bool bRetryDue     = !TimeMgr::IsWallClockValid() || bNeverRetried || bHeldOver ||
                                (uptimeSec - m_nLastTimeSyncAttemptSec >= timeSyncRetryIntervalSec);
-        if (bRetryDue)
+        // With PPS every new RMC time is paired with its edge, quietly as it runs once a second
+        const bool bPpsDue = m_spTimeMgr->HasPps() && m_spGPSData->nGPSTimeUs != m_nLastGpsTimeUs;
+        if (bPpsDue && !bRetryDue)
+        {
+            m_nLastGpsTimeUs = m_spGPSData->nGPSTimeUs;
+            m_spTimeMgr->SetTimeFromGps(m_spGPSData->strGPSTimeRaw, m_spGPSData->strGPSDateRaw, m_spGPSData->nGPSTimeUs);
+        }
+        else if (bRetryDue)
         {
             m_nLastTimeSyncAttemptSec = uptimeSec;
+            m_nLastGpsTimeUs          = m_spGPSData->nGPSTimeUs;
             LogInfo("Attempting GPS time sync");
-            if (m_spTimeMgr->SetTimeFromGps(m_spGPSData->strGPSTimeRaw, m_spGPSData->strGPSDateRaw))
+            if (m_spTimeMgr->SetTimeFromGps(m_spGPSData->strGPSTimeRaw, m_spGPSData->strGPSDateRaw, m_spGPSData->nGPSTimeUs))
             {
                 LogInfo("GPS time synchronized");
             }
             else
             {
-                LogInfo("GPS time sync failed");
+                LogWarn("GPS time sync failed");
             }
         }
     }
 
+    // Cheap once the year's transitions are cached, and flips DST on the hour rather than at the next sync
+    if (TimeMgr::IsWallClockValid())
+    {
+        m_spTimeMgr->RefreshTimeZoneOffset();
+    }
+
+    if (m_spConsole)
+    {
+        return; // The console owns the display
+    }
+
+    updatePowerMode();
+
     uint16_t nWidth  = m_spDisplay->Width();
     uint16_t nHeight = m_spDisplay->Height();
 
@@ -174,8 +254,16 @@ void GPS_TFT::updateUI(GPSData::Shared spGPSData)
     }
 #endif
 
+    m_spDisplay->WaitForNextFrame(); // no-op unless a frame interval is set
+    m_spDisplay->BeginFrame();       // at most one V-blank wait per frame
+
+#if !defined(NDEBUG) || LOG_LEVEL >= LOG_LEVEL_DEBUG
     auto startTime           = time_us_64();
     static uint64_t showTime = 0;
+#endif
+
+    // Broken down once per frame, not per quadrant
+    const TimeMgr::CivilTime& localTime = m_spTimeMgr->LocalNow();
 
     for (auto nQuadrant : m_spDisplay->GetQuadrants())
     {
@@ -217,16 +305,16 @@ void GPS_TFT::updateUI(GPSData::Shared spGPSData)
 #endif
 
         // Draw clock
-        if (!spGPSData->strGPSTime.empty())
+        if (!spGPSData->strGPSTime.empty() && TimeMgr::IsWallClockValid())
         {
             uint lineHeight = getCharHeight() + 1;
             uint radius     = m_spDisplay->ShorterSide() / 8;
             uint xPos       = m_spDisplay->Landscape() ? nWidth / 2 : X_PAD + getCharWidth() * 3;
-            drawClock(xPos, lineHeight * PAD_CHARS_Y, radius, spGPSData->strGPSTime);
+            drawClock(xPos, lineHeight * PAD_CHARS_Y, radius, localTime);
         }
 
         // Draw bar graph
-        if (m_spGPSData->mSatList.size() > 0)
+        if (!m_spGPSData->Sats().Empty())
         {
             if (m_spDisplay->Landscape())
             {
@@ -246,16 +334,63 @@ void GPS_TFT::updateUI(GPSData::Shared spGPSData)
 // blit the framebuf to the display quadrant
         m_spDisplay->Show();
     }
+#if !defined(NDEBUG) || LOG_LEVEL >= LOG_LEVEL_DEBUG
     showTime = time_us_64() - startTime;
+#endif
 
     m_spGPSData.reset();
 
-    LogInfo("Frame show: " + std::to_string(showTime / 1000) + "ms");
+    LogDebug("Frame show: %ums, missed: %u", (unsigned int)(showTime / 1000), (unsigned int)m_spDisplay->MissedFrames());
 #if !defined(NDEBUG)
-    std::cout << "Total Heap: " << getTotalHeap() << "  Free Heap: " << getFreeHeap() << std::endl;
+    LogDebug("Total Heap: %u  Free Heap: %u", (unsigned int)getTotalHeap(), (unsigned int)getFreeHeap());
 #endif
 }
 
+void GPS_TFT::updatePowerMode()
+{
+    // The fix is unchanged while position (to the four decimals shown), fix mode and satellite count stay the same
+    const GPSData& fix       = *m_spGPSData;
+    const int32_t nLatitude  = fix.nLatitudeE7 / fixResolutionE7;
+    const int32_t nLongitude = fix.nLongitudeE7 / fixResolutionE7;
+    const uint64_t now       = time_us_64();
+    if (fix.bHasPosition != m_bLastHasPosition || nLatitude != m_nLastLatitude || nLongitude != m_nLastLongitude ||
+        fix.strMode3D != m_strLastMode3D || fix.strNumSats != m_strLastNumSats)
+    {
+        m_bLastHasPosition = fix.bHasPosition;
+        m_nLastLatitude    = nLatitude;
+        m_nLastLongitude   = nLongitude;
+        m_strLastMode3D    = fix.strMode3D;
+        m_strLastNumSats   = fix.strNumSats;
+        m_nLastFixChangeUs = now;
+        if (m_bLowPower)
+        {
+            LogInfo("Fix changed, leaving low power display mode");
+            m_spDisplay->NormalMode();
+            m_spDisplay->SetIdleMode(false);
+            m_spDisplay->SetBacklight(100);
+            m_bLowPower = false;
+        }
+        return;
+    }
+
+    if (!m_bLowPower && now - m_nLastFixChangeUs >= lowPowerAfterSec * 1000 * 1000)
+    {
+        LogInfo("Fix unchanged, entering low power display mode");
+        // Keep only the text panel (and clock) lit: the right half in landscape, the top lines in portrait
+        if (m_spDisplay->Landscape())
+        {
+            m_spDisplay->SetPartialArea(m_spDisplay->Width() / 2, m_spDisplay->Width() - 1);
+        }
+        else
+        {
+            m_spDisplay->SetPartialArea(0, linePos(7) - 1);
+        }
+        m_spDisplay->SetIdleMode(true);
+        m_spDisplay->SetBacklight(lowPowerBacklightPercent);
+        m_bLowPower = true;
+    }
+}
+
 void GPS_TFT::drawSatGrid(uint xCenter, uint yCenter, uint radius, uint nRings)
 {
     for (uint i = 1; i <= nRings; ++i)
@@ -275,20 +410,14 @@ void GPS_TFT::drawSatGrid(uint xCenter, uint yCenter, uint radius, uint nRings)
     {
         satRadius = SAT_ICON_RADIUS;
     }
-    for (auto oEntry : m_spGPSData->mSatList)
+    const SatTable& oSats = m_spGPSData->Sats();
+    for (size_t i = 0; i < oSats.Size(); i++)
     {
-        auto oSat    = oEntry.second;
-        double elrad = oSat.m_el * pi / 180;
-        double azrad = oSat.m_az * pi / 180;
-        drawCircleSat(xCenter, yCenter, radius, elrad, azrad, satRadius, COLOUR_WHITE, COLOUR_BLACK);
-        for (auto nSat : m_spGPSData->vUsedList)
-        {
-            if (oSat.m_num == nSat)
-            {
-                drawCircleSat(xCenter, yCenter, radius, elrad, azrad, satRadius, COLOUR_WHITE, COLOUR_BLUE);
-                break;
-            }
-        }
+        const SatInfo& oSat = oSats[i];
+        double elrad        = oSat.m_el * pi / 180;
+        double azrad        = oSat.m_az * pi / 180;
+        uint16_t colour     = systemColour(oSat.m_system);
+        drawCircleSat(xCenter, yCenter, radius, elrad, azrad, satRadius, colour, oSats.IsUsed(i) ? COLOUR_BLUE : COLOUR_BLACK);
     }
 }
 
@@ -321,17 +450,39 @@ void GPS_TFT::drawBarGraph(uint x, uint y, uint width, uint height)
     uint barDelta     = bNarrow ? std::max(std::min(charWidth * 2 + 4, width / nMaxSats), charWidth * 2)
                                 : std::max(std::min(charWidth + 4, width / nMaxSats), charWidth);
     uint barWidth     = barDelta - 2;
-    uint barPosX      = x + width - (m_spGPSData->mSatList.size() * barDelta);
+    uint nBarsFit     = width / barDelta;
     uint barHeightMax = height - (charHeight + 1) * 2;
 
-    for (auto oEntry : m_spGPSData->mSatList)
+    // With more satellites in view than bars fit, leave out those with no signal first
+    const SatTable& oSats = m_spGPSData->Sats();
+    uint nSats            = oSats.Size();
+    bool bSkipLow         = nSats > nBarsFit;
+    if (bSkipLow)
     {
-        auto oSat      = oEntry.second;
-        uint rssi      = oSat.m_rssi;
-        uint barHeight = (int)((double)barHeightMax * (double)rssi / 64);
-        uint baseLineY = y + barHeightMax;
+        nSats = 0;
+        for (size_t i = 0; i < oSats.Size(); i++)
+        {
+            nSats += (oSats[i].m_rssi > 0) ? 1 : 0;
+        }
+    }
+    nSats        = std::min(nSats, nBarsFit);
+    uint barPosX = x + width - (nSats * barDelta);
+
+    for (size_t i = 0; i < oSats.Size() && nSats > 0; i++)
+    {
+        if (bSkipLow && oSats[i].m_rssi == 0)
+        {
+            continue;
+        }
+        nSats--;
+
+        const SatInfo& oSat = oSats[i];
+        uint rssi           = oSat.m_rssi;
+        uint barHeight      = (int)((double)barHeightMax * (double)rssi / 64);
+        uint baseLineY      = y + barHeightMax;
+        uint16_t colour     = systemColour(oSat.m_system);
         m_spDisplay->HLine(barPosX, baseLineY, barDelta, COLOUR_WHITE);
-        uint nSat = oSat.m_num;
+        uint nSat = oSat.m_num % 100; // extended PRNs keep their last two digits
 
         std::stringstream oss;
         oss << std::fixed << std::setw(2) << std::setfill('0') << std::setprecision(0) << nSat;
@@ -340,44 +491,33 @@ void GPS_TFT::drawBarGraph(uint x, uint y, uint width, uint height)
         uint charPosX = bNarrow ? barPosX + (barDelta - (2 * charWidth)) / 2 : barPosX + (barDelta - charWidth) / 2;
         if (bNarrow)
         {
-            m_spDisplay->Text(strSatNum.c_str(), charPosX, baseLineY + 2, COLOUR_WHITE, *pFont);
+            m_spDisplay->Text(strSatNum.c_str(), charPosX, baseLineY + 2, colour, *pFont);
         }
         else
         {
-            m_spDisplay->Text(strSatNum.substr(0, 1).c_str(), charPosX, baseLineY + 2, COLOUR_WHITE);
-            m_spDisplay->Text(strSatNum.substr(1, 1).c_str(), charPosX, baseLineY + charHeight, COLOUR_WHITE);
+            m_spDisplay->Text(strSatNum.substr(0, 1).c_str(), charPosX, baseLineY + 2, colour);
+            m_spDisplay->Text(strSatNum.substr(1, 1).c_str(), charPosX, baseLineY + charHeight, colour);
         }
         if (barHeight > 0)
         {
-            m_spDisplay->Rect(barPosX + 1, baseLineY - barHeight + 1, barWidth, barHeight, COLOUR_WHITE);
+            m_spDisplay->Rect(barPosX + 1, baseLineY - barHeight + 1, barWidth, barHeight, colour);
         }
-        for (auto nSat : m_spGPSData->vUsedList)
+        if (oSats.IsUsed(i) && barHeight > 0)
         {
-            if (oSat.m_num == nSat)
-            {
-                if (barHeight > 0)
-                {
-                    // draw inner filled rectangle to indicate used satellite
-                    m_spDisplay->Rect(barPosX + 2, baseLineY - barHeight + 2, barWidth - 2, barHeight - 2, COLOUR_BLUE, true);
-                }
-                break;
-            }
+            // draw inner filled rectangle to indicate used satellite
+            m_spDisplay->Rect(barPosX + 2, baseLineY - barHeight + 2, barWidth - 2, barHeight - 2, COLOUR_BLUE, true);
         }
         barPosX += barDelta;
     }
 }
 
-void GPS_TFT::drawClock(uint x, uint y, uint radius, std::string strTime)
+void GPS_TFT::drawClock(uint x, uint y, uint radius, const TimeMgr::CivilTime& localTime)
 {
     uint xCenter             = x + radius;
     uint yCenter             = y + radius;
-    uint nHour               = atoi(strTime.substr(0, 2).c_str());
-    const float gmtOffset    = m_spTimeMgr ? m_spTimeMgr->TimeZoneOffsetHours() : 0.0f;
-    float hour               = (float)(nHour % 12) + gmtOffset;
-    hour                     = (hour < 0) ? hour + 12 : hour;
-    hour                     = (hour >= 12) ? hour - 12 : hour;
-    float minute             = (float)atoi(strTime.substr(3, 2).c_str());
-    float second             = (float)atoi(strTime.substr(6, 2).c_str());
+    float hour               = (float)(localTime.hour % 12);
+    float minute             = (float)localTime.minute;
+    float second             = (float)localTime.second;
     uint16_t ringColor       = COLOUR_LIME;
     uint16_t faceColor       = COLOUR_BLACK;
     uint16_t handColor       = COLOUR_WHITE;
@@ -16,6 +16,7 @@
 #include "gps.h"
 #include "ili_tft.h"
 #include "led.h"
+#include "scroll_console.h"
 #include "font.h"
 
 // GPS_TFT class
@@ -37,14 +38,18 @@ public:
     void Initialize();
     void Run();
 
+    // Draws one frame from spGPSData; the GPS data callback lands here, and the host tests call it directly
+    void UpdateUI(GPSData::Shared spGPSData);
+
 private:
     static void sentenceCB(void* pCtx, std::string strSentence);
     static void gpsDataCB(void* pCtx, GPSData::Shared spGPSData);
+    static void idleCB(void* pCtx);
 
-    void updateUI(GPSData::Shared spGPSData);
+    void updatePowerMode();
     void drawSatGrid(uint xCenter, uint yCenter, uint radius, uint nRings = 3);
     void drawBarGraph(uint x, uint y, uint width, uint height);
-    void drawClock(uint x, uint y, uint radius, std::string strTime);
+    void drawClock(uint x, uint y, uint radius, const TimeMgr::CivilTime& localTime);
     void drawCircleSat(uint gridCenterX,
                        uint gridCenterY,
                        uint nGridRadius,
@@ -82,5 +87,14 @@ private:
     LED::Shared m_spLED;
     GPSData::Shared m_spGPSData;
     TimeMgr::Shared m_spTimeMgr;
+    ScrollConsole::Shared m_spConsole;
     uint64_t m_nLastTimeSyncAttemptSec;
+    uint64_t m_nLastGpsTimeUs;
+    bool m_bLastHasPosition;
+    int32_t m_nLastLatitude; // at the resolution shown
+    int32_t m_nLastLongitude;
+    std::string m_strLastMode3D;
+    std::string m_strLastNumSats;
+    uint64_t m_nLastFixChangeUs;
+    bool m_bLowPower;
 };
@@ -0,0 +1,171 @@
+/*
+ * Headless TFT display class
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "headless_tft.h"
+
+HeadlessTFT::HeadlessTFT(uint16_t hwWidth, uint16_t hwHeight, ROTATION rotation)
+    : ILI_TFT(nullptr, 0, 0, 0, rotation),
+      m_hwWidth(hwWidth),
+      m_hwHeight(hwHeight),
+      m_nCmd(0),
+      m_x0(0),
+      m_x1(0),
+      m_y0(0),
+      m_y1(0),
+      m_x(0),
+      m_y(0),
+      m_nCarry(0)
+{
+}
+
+void HeadlessTFT::Reset()
+{
+    m_nCmd   = 0;
+    m_nCarry = 0;
+}
+
+void HeadlessTFT::Initialize()
+{
+    setRotation(m_hwWidth, m_hwHeight, m_rotation); // Sets width, height and MADCTL value
+    createFramebuf();
+    m_vImage.assign(static_cast<size_t>(m_dispWidth) * m_dispHeight * 3, 0);
+    Reset();
+}
+
+bool HeadlessTFT::WritePPM(const std::string& strPath) const
+{
+    FILE* pFile = fopen(strPath.c_str(), "wb");
+    if (pFile == nullptr)
+    {
+        return false;
+    }
+    fprintf(pFile, "P6\n%u %u\n255\n", (unsigned int)m_dispWidth, (unsigned int)m_dispHeight);
+    bool bOk = fwrite(m_vImage.data(), 1, m_vImage.size(), pFile) == m_vImage.size();
+    fclose(pFile);
+    return bOk;
+}
+
+bool HeadlessTFT::ReadPPM(const std::string& strPath, std::vector<uint8_t>& vImage) const
+{
+    FILE* pFile = fopen(strPath.c_str(), "rb");
+    if (pFile == nullptr)
+    {
+        return false;
+    }
+    unsigned int w = 0, h = 0, maxval = 0;
+    bool bOk = fscanf(pFile, "P6 %u %u %u", &w, &h, &maxval) == 3 && fgetc(pFile) != EOF && w == m_dispWidth && h == m_dispHeight &&
+               maxval == 255;
+    if (bOk)
+    {
+        vImage.resize(static_cast<size_t>(w) * h * 3);
+        bOk = fread(vImage.data(), 1, vImage.size(), pFile) == vImage.size();
+    }
+    fclose(pFile);
+    return bOk;
+}
+
+uint32_t HeadlessTFT::CountDifferences(const std::vector<uint8_t>& vImage) const
+{
+    if (vImage.size() != m_vImage.size())
+    {
+        return static_cast<uint32_t>(m_vImage.size() / 3);
+    }
+    uint32_t nDiffs = 0;
+    for (size_t i = 0; i < m_vImage.size(); i += 3)
+    {
+        if (memcmp(&m_vImage[i], &vImage[i], 3) != 0)
+        {
+            ++nDiffs;
+        }
+    }
+    return nDiffs;
+}
+
+void HeadlessTFT::writeCmd(uint8_t cmd, uint8_t* data, size_t dataLen)
+{
+    m_nCmd   = cmd;
+    m_nCarry = 0;
+    switch (cmd)
+    {
+    case _CASET:
+        if (data != NULL && dataLen >= 4)
+        {
+            m_x0 = (data[0] << 8) | data[1];
+            m_x1 = (data[2] << 8) | data[3];
+        }
+        break;
+    case _PASET:
+        if (data != NULL && dataLen >= 4)
+        {
+            m_y0 = (data[0] << 8) | data[1];
+            m_y1 = (data[2] << 8) | data[3];
+        }
+        break;
+    case _RAMWR:
+        m_x = m_x0;
+        m_y = m_y0;
+        break;
+    default:
+        break;
+    }
+}
+
+void HeadlessTFT::sendData(uint8_t data)
+{
+    (void)data; // Command parameters are passed to writeCmd
+}
+
+void HeadlessTFT::sendFramebufferData(uint8_t* data, size_t dataLen)
+{
+    if (m_nCmd != _RAMWR)
+    {
+        return;
+    }
+    const size_t bytesPerPixel = (m_colmod == 0x66) ? 3 : 2;
+    for (size_t i = 0; i < dataLen; ++i)
+    {
+        m_carry[m_nCarry++] = data[i];
+        if (m_nCarry == bytesPerPixel)
+        {
+            putPixel(m_carry);
+            m_nCarry = 0;
+        }
+    }
+}
+
+void HeadlessTFT::putPixel(const uint8_t* pPixel)
+{
+    if (m_y > m_y1)
+    {
+        return; // Past the end of the window, the panel ignores further data
+    }
+    if (m_x < m_dispWidth && m_y < m_dispHeight)
+    {
+        uint8_t* pOut = &m_vImage[(static_cast<size_t>(m_y) * m_dispWidth + m_x) * 3];
+        if (m_colmod == 0x66)
+        {
+            pOut[0] = pPixel[0];
+            pOut[1] = pPixel[1];
+            pOut[2] = pPixel[2];
+        }
+        else
+        {
+            uint16_t pixel565 = (pPixel[0] << 8) | pPixel[1];
+            pOut[0]           = ((pixel565 >> 11) & 0x1f) << 3;
+            pOut[1]           = ((pixel565 >> 5) & 0x3f) << 2;
+            pOut[2]           = (pixel565 & 0x1f) << 3;
+        }
+    }
+    if (++m_x > m_x1)
+    {
+        m_x = m_x0;
+        ++m_y;
+    }
+}
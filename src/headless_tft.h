@@ -0,0 +1,52 @@
+/*
+ * Headless TFT display class
+ *
+ * (c) 2026 Erik Tkal
+ *
+ * Notes:
+ *   1) Decodes the CASET/PASET/RAMWR command stream that ILI_TFT would send over SPI
+ *      into an in-memory RGB888 image instead of driving a panel, so what GPS_TFT draws
+ *      can be inspected or compared against golden images on a host.
+ *   2) The image is in display (rotated) coordinates; MADCTL, scrolling and power
+ *      commands are accepted and ignored.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ili_tft.h"
+
+class HeadlessTFT : public ILI_TFT
+{
+public:
+    HeadlessTFT(uint16_t hwWidth, uint16_t hwHeight, ROTATION rotation = R0DEG);
+    virtual ~HeadlessTFT() = default;
+
+    void Initialize() override;
+    void Reset() override;
+
+    const std::vector<uint8_t>& Image() const
+    {
+        return m_vImage;
+    }
+    bool WritePPM(const std::string& strPath) const;
+    bool ReadPPM(const std::string& strPath, std::vector<uint8_t>& vImage) const;
+    uint32_t CountDifferences(const std::vector<uint8_t>& vImage) const;
+
+private:
+    void writeCmd(uint8_t cmd, uint8_t* data = NULL, size_t dataLen = 0) override;
+    void sendData(uint8_t data) override;
+    void sendFramebufferData(uint8_t* data, size_t dataLen = 0) override;
+    void putPixel(const uint8_t* pPixel);
+
+    uint16_t m_hwWidth;
+    uint16_t m_hwHeight;
+    std::vector<uint8_t> m_vImage; // RGB888, Width() x Height()
+    uint8_t m_nCmd;
+    uint16_t m_x0, m_x1, m_y0, m_y1;
+    uint16_t m_x, m_y;
+    uint8_t m_carry[3];
+    size_t m_nCarry;
+};
@@ -45,12 +45,13 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "stdlib.h"
 #include "stdio.h"
-#include <iostream>
 #include <cstring>
 #include <vector>
 
 #include "ili_tft.h"
+#include "timemgr.h"
 #include "hardware/gpio.h"
+#include "hardware/irq.h"
 
 #ifndef pgm_read_byte
 #define pgm_read_byte(addr) (*(const uint8_t*)(addr))
@@ -61,6 +62,15 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef pgm_read_dword
 #define pgm_read_dword(addr) (*(const uint32_t*)(addr))
 #endif
+// Readback is specified much slower than writes (~150ns read cycle on the ILI9341)
+constexpr uint32_t readbackSpiSpeed = 6000000;
+
+// Static members for TE interrupt
+uint ILI_TFT::sm_nTEPin                     = 0;
+volatile uint32_t ILI_TFT::sm_nVBlankCount  = 0;
+volatile uint64_t ILI_TFT::sm_nLastVBlankUs = 0;
+volatile uint32_t ILI_TFT::sm_nRefreshUs    = 0;
+
 #ifndef __swap_int
 #define __swap_int(a, b)   \
     a = (a & b) + (a | b); \
@@ -75,12 +85,22 @@ ILI_TFT::ILI_TFT(spi_inst_t* spi, uint8_t cs, uint8_t dc, uint8_t rst, ROTATION
       m_rst(rst),
       m_dispWidth(0),
       m_dispHeight(0),
+      m_hwHeight(0),
       m_rotation(rotation),
       m_madctl(DISPLAY_COLOUR_ORDER),
       m_nQuadrants(DISPLAY_QUADRANTS),
       m_eQuadrant(FULL_FRAME),
       m_xoff(0),
-      m_yoff(0)
+      m_yoff(0),
+      m_scrollTop(0),
+      m_scrollHeight(0),
+      m_bTearingSync(false),
+      m_bFrameSynced(false),
+      m_nFrameIntervalUs(0),
+      m_nNextFrameUs(0),
+      m_nMissedFrames(0),
+      m_bSleeping(false),
+      m_nBacklightPin(-1)
 {
     switch (DISPLAY_COLOUR_FORMAT)
     {
@@ -287,7 +307,7 @@ void ILI_TFT::Clear(uint16_t colour)
         Fill(COLOUR_BLACK);
         Show();
     }
-    std::cout << "Display cleared." << std::endl;
+    LogDebug("Display cleared.");
 }
 
 void ILI_TFT::SetQuadrant(QUADRANT eQuadrant)
@@ -326,6 +346,7 @@ std::list<QUADRANT> ILI_TFT::GetQuadrants()
 
 void ILI_TFT::setRotation(uint16_t screenWidth, uint16_t screenHeight, ROTATION rotation)
 {
+    m_hwHeight = screenHeight;
     switch (rotation)
     {
     case R0DEG:
@@ -479,9 +500,27 @@ void ILI_TFT::Show()
 
 void ILI_TFT::Show(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
 {
-    uint16_t disp_x = x + m_xoff;
-    uint16_t disp_y = y + m_yoff;
+    if (m_bTearingSync && !m_bFrameSynced && blitFitsRefresh(w, h))
+    {
+        m_bFrameSynced = true;
+        WaitForVBlank();
+    }
+    Blit(x, y, w, h, x + m_xoff, y + m_yoff);
+}
 
+bool ILI_TFT::blitFitsRefresh(uint16_t w, uint16_t h) const
+{
+    const uint32_t nRefreshUs = sm_nRefreshUs;
+    if (nRefreshUs == 0)
+    {
+        return false; // no refresh period measured yet
+    }
+    const uint64_t nBits = static_cast<uint64_t>(w) * h * ((m_colmod == 0x66) ? 24 : 16);
+    return nBits * 1000000 / spi_get_baudrate(m_spi) <= nRefreshUs;
+}
+
+void ILI_TFT::Blit(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t dispX, uint16_t dispY)
+{
     uint16_t _x = MIN(Framebuf::width() - 1, MAX(0, x));
     uint16_t _y = MIN(Framebuf::height() - 1, MAX(0, y));
     uint16_t _w = MIN(Framebuf::width() - x, MAX(1, w));
@@ -490,7 +529,7 @@ void ILI_TFT::Show(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
     uint8_t* pSrcData8 = reinterpret_cast<uint8_t*>(Framebuf::buffer());
     if (pSrcData8 == nullptr)
     {
-        std::cout << "Framebuf::buffer() is nullptr, nothing to show" << std::endl;
+        LogError("Framebuf::buffer() is nullptr, nothing to show");
         return;
     }
     uint16_t fWidth = Framebuf::width(); // framebuf width
@@ -515,7 +554,7 @@ void ILI_TFT::Show(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
     // Fallback path if a single line does not fit in the staging buffer.
     if (bytesPerLine > chunkBufferBytes)
     {
-        writeBlock(disp_x, disp_y, disp_x + _w - 1, disp_y + _h - 1);
+        writeBlock(dispX, dispY, dispX + _w - 1, dispY + _h - 1);
         for (uint16_t iy = 0; iy < _h; ++iy)
         {
             size_t nSrcOffset = (static_cast<size_t>(_y + iy) * fWidth * bytesPerPixel) + (static_cast<size_t>(_x) * bytesPerPixel);
@@ -533,7 +572,7 @@ void ILI_TFT::Show(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
     uint16_t linesLeftover = _h - numChunks * linesPerChunk;
 
     // Tell the display where we are going to write the data
-    writeBlock(disp_x, disp_y, disp_x + _w - 1, disp_y + _h - 1);
+    writeBlock(dispX, dispY, dispX + _w - 1, dispY + _h - 1);
     for (uint16_t nChunk = 0; nChunk < numChunks; ++nChunk)
     {
         for (uint16_t iy = 0; iy < linesPerChunk; ++iy)
@@ -554,6 +593,319 @@ void ILI_TFT::Show(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
     sendFramebufferData(tgtBuffer, static_cast<size_t>(linesLeftover) * bytesPerLine);
 }
 
+void ILI_TFT::SetScrollArea(uint16_t topFixed, uint16_t bottomFixed)
+{
+    if (topFixed + bottomFixed >= m_hwHeight)
+    {
+        return;
+    }
+    m_scrollTop    = topFixed;
+    m_scrollHeight = m_hwHeight - topFixed - bottomFixed;
+
+    // The fixed areas are defined in panel order; with MADCTL_MY the viewer's top is the panel's bottom
+    uint16_t tfa = (m_madctl & MADCTL_MY) ? bottomFixed : topFixed;
+    uint16_t bfa = (m_madctl & MADCTL_MY) ? topFixed : bottomFixed;
+
+    uint16_t buffer[3];
+    buffer[0] = __builtin_bswap16(tfa);
+    buffer[1] = __builtin_bswap16(m_scrollHeight);
+    buffer[2] = __builtin_bswap16(bfa);
+    writeCmd(_VSCRDEF, reinterpret_cast<uint8_t*>(buffer), 6);
+    SetScrollOffset(0);
+}
+
+void ILI_TFT::SetScrollOffset(uint16_t offset)
+{
+    if (m_scrollHeight == 0)
+    {
+        return;
+    }
+    offset %= m_scrollHeight;
+
+    // VSCRSADD is the memory line shown at the top of the panel's scroll area.  With MADCTL_MY the
+    // memory rows run opposite to the viewer, so the start address moves the other way.
+    uint16_t tfa   = (m_madctl & MADCTL_MY) ? (m_hwHeight - m_scrollTop - m_scrollHeight) : m_scrollTop;
+    uint16_t start = (m_madctl & MADCTL_MY) ? tfa + (m_scrollHeight - offset) % m_scrollHeight : tfa + offset;
+
+    uint16_t buffer = __builtin_bswap16(start);
+    writeCmd(_VSCRSADD, reinterpret_cast<uint8_t*>(&buffer), 2);
+}
+
+void ILI_TFT::ResetScroll()
+{
+    if (m_scrollHeight == 0)
+    {
+        return;
+    }
+    SetScrollOffset(0);
+    writeCmd(_NORON); // leave scroll mode
+    m_scrollTop    = 0;
+    m_scrollHeight = 0;
+}
+
+void ILI_TFT::EnableTearingSync(uint pin)
+{
+    sm_nTEPin        = pin;
+    sm_nVBlankCount  = 0;
+    sm_nLastVBlankUs = 0;
+    sm_nRefreshUs    = 0;
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
+    gpio_add_raw_irq_handler(pin, on_te_irq);
+    gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    writeCmd(_TEON, (uint8_t*)"\x00", 1); // TE output on V-blanking only
+    m_bTearingSync = true;
+}
+
+void ILI_TFT::DisableTearingSync()
+{
+    if (!m_bTearingSync)
+    {
+        return;
+    }
+    writeCmd(_TEOFF);
+    gpio_set_irq_enabled(sm_nTEPin, GPIO_IRQ_EDGE_RISE, false);
+    m_bTearingSync = false;
+}
+
+bool ILI_TFT::WaitForVBlank(uint32_t timeoutUs)
+{
+    if (!m_bTearingSync)
+    {
+        return false;
+    }
+    const uint32_t nCount          = sm_nVBlankCount;
+    const absolute_time_t timeoutAt = make_timeout_time_us(timeoutUs);
+    while (sm_nVBlankCount == nCount)
+    {
+        if (absolute_time_diff_us(get_absolute_time(), timeoutAt) <= 0)
+        {
+            return false; // TE not toggling, don't stall presentation
+        }
+        tight_loop_contents();
+    }
+    return true;
+}
+
+void ILI_TFT::SetFrameInterval(uint32_t intervalUs)
+{
+    m_nFrameIntervalUs = intervalUs;
+    m_nNextFrameUs     = time_us_64() + intervalUs;
+    m_nMissedFrames    = 0;
+}
+
+bool ILI_TFT::WaitForNextFrame()
+{
+    if (m_nFrameIntervalUs == 0)
+    {
+        return true;
+    }
+
+    const uint64_t now = time_us_64();
+    if (now > m_nNextFrameUs)
+    {
+        // Overran the slot; re-align rather than trying to catch up with back-to-back frames
+        m_nMissedFrames += 1;
+        m_nNextFrameUs = now + m_nFrameIntervalUs;
+        return false;
+    }
+
+    sleep_us(m_nNextFrameUs - now);
+    m_nNextFrameUs += m_nFrameIntervalUs;
+    return true;
+}
+
+void ILI_TFT::Sleep(bool bSleep)
+{
+    if (bSleep == m_bSleeping)
+    {
+        return;
+    }
+    if (bSleep)
+    {
+        writeCmd(_DISPOFF);
+        writeCmd(_SLPIN);
+        sleep_ms(5);
+    }
+    else
+    {
+        writeCmd(_SLPOUT);
+        sleep_ms(120); // required before the next sleep command, and for the supply to settle
+        writeCmd(_DISPON);
+    }
+    m_bSleeping = bSleep;
+}
+
+void ILI_TFT::SetIdleMode(bool bIdle)
+{
+    writeCmd(bIdle ? _IDMON : _IDMOFF);
+}
+
+void ILI_TFT::SetPartialArea(uint16_t start, uint16_t end)
+{
+    if (start > end || end >= m_hwHeight)
+    {
+        return;
+    }
+    // MX mirrors the column counter and MY the page counter; MV sends the column counter to the
+    // panel rows.  So the viewer coordinate runs opposite to the panel rows with MY in portrait
+    // rotations, and with MX in landscape ones.
+    const uint8_t rowMirror = (m_madctl & MADCTL_MV) ? MADCTL_MX : MADCTL_MY;
+    uint16_t sr             = (m_madctl & rowMirror) ? m_hwHeight - 1 - end : start;
+    uint16_t er             = (m_madctl & rowMirror) ? m_hwHeight - 1 - start : end;
+
+    uint16_t buffer[2];
+    buffer[0] = __builtin_bswap16(sr);
+    buffer[1] = __builtin_bswap16(er);
+    writeCmd(_PTLAR, reinterpret_cast<uint8_t*>(buffer), 4);
+    writeCmd(_PTLON);
+}
+
+void ILI_TFT::NormalMode()
+{
+    writeCmd(_NORON);
+    m_scrollTop    = 0; // also ends vertical scrolling
+    m_scrollHeight = 0;
+}
+
+void ILI_TFT::SetBacklightPin(uint pin)
+{
+    m_nBacklightPin   = pin;
+    uint slice        = pwm_gpio_to_slice_num(pin);
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv(&config, 4.0f); // ~31kHz at 125MHz, above audible and visible flicker
+    pwm_config_set_wrap(&config, 999);
+    pwm_init(slice, &config, true);
+    gpio_set_function(pin, GPIO_FUNC_PWM);
+    SetBacklight(0);
+}
+
+void ILI_TFT::SetBacklight(uint8_t percent)
+{
+    if (m_nBacklightPin < 0)
+    {
+        return;
+    }
+    percent = MIN(percent, 100);
+    pwm_set_gpio_level(m_nBacklightPin, percent * 10);
+}
+
+uint32_t ILI_TFT::Verify(uint16_t x, uint16_t y, uint16_t w, uint16_t h, std::vector<uint16_t>* pBadLines)
+{
+    uint8_t* pSrcData8   = reinterpret_cast<uint8_t*>(Framebuf::buffer());
+    size_t bytesPerPixel = Framebuf::pixelSize();
+    if (pSrcData8 == nullptr || (bytesPerPixel != 2 && bytesPerPixel != 3))
+    {
+        return 0;
+    }
+    if (x >= Framebuf::width() || y >= Framebuf::height() || w == 0 || h == 0)
+    {
+        return 0; // nothing of the framebuf to compare
+    }
+    uint16_t _w = MIN(Framebuf::width() - x, w);
+    uint16_t _h = MIN(Framebuf::height() - y, h);
+
+    const uint32_t nWriteSpeed = spi_get_baudrate(m_spi);
+    spi_set_baudrate(m_spi, readbackSpiSpeed);
+
+    // RAMRD always returns 3 bytes per pixel, each component in the upper 6 bits
+    std::vector<uint8_t> vLine(static_cast<size_t>(_w) * 3);
+    uint32_t nBadLines = 0;
+    for (uint16_t iy = 0; iy < _h; ++iy)
+    {
+        uint16_t dispY = y + iy + m_yoff;
+        readBlock(x + m_xoff, dispY, x + m_xoff + _w - 1, dispY, vLine.data(), vLine.size());
+
+        const uint8_t* pSrc = &pSrcData8[(static_cast<size_t>(y + iy) * Framebuf::width() + x) * bytesPerPixel];
+        bool bMatch         = true;
+        for (uint16_t ix = 0; ix < _w && bMatch; ++ix, pSrc += bytesPerPixel)
+        {
+            uint8_t r, g, b;
+            if (bytesPerPixel == 2) // big-endian RGB565
+            {
+                r = pSrc[0] & 0xf8;
+                g = ((pSrc[0] & 0x07) << 5) | ((pSrc[1] & 0xe0) >> 3);
+                b = (pSrc[1] & 0x1f) << 3;
+            }
+            else
+            {
+                r = pSrc[0];
+                g = pSrc[1];
+                b = pSrc[2];
+            }
+            const uint8_t* pRead = &vLine[ix * 3];
+            bMatch               = (pRead[0] & 0xf8) == (r & 0xf8) && (pRead[1] & 0xfc) == (g & 0xfc) &&
+                     (pRead[2] & 0xf8) == (b & 0xf8);
+        }
+        if (!bMatch)
+        {
+            ++nBadLines;
+            if (pBadLines != nullptr)
+            {
+                pBadLines->push_back(y + iy);
+            }
+        }
+    }
+
+    spi_set_baudrate(m_spi, nWriteSpeed);
+    return nBadLines;
+}
+
+uint32_t ILI_TFT::MeasureSpiCeiling(const std::vector<uint32_t>& vSpeeds)
+{
+    const uint32_t nOriginalSpeed = spi_get_baudrate(m_spi);
+    uint32_t nCeiling             = 0;
+
+    // Test pattern with every bit toggling between neighbouring pixels
+    static const uint16_t pattern[] = {COLOUR_WHITE, COLOUR_BLACK, 0xaaaa, 0x5555, COLOUR_RED, COLOUR_LIME, COLOUR_BLUE, 0x0f0f};
+    for (int ny = 0; ny < Framebuf::height(); ++ny)
+    {
+        for (int nx = 0; nx < Framebuf::width(); ++nx)
+        {
+            Framebuf::setpixel(nx, ny, pattern[(nx + ny) % (sizeof(pattern) / sizeof(pattern[0]))]);
+        }
+    }
+
+    for (auto nSpeed : vSpeeds)
+    {
+        const uint32_t nActual = spi_set_baudrate(m_spi, nSpeed);
+        uint32_t nBadLines     = 0;
+        for (auto nQuadrant : GetQuadrants())
+        {
+            SetQuadrant(nQuadrant);
+            Show();
+            nBadLines += Verify(0, 0, Framebuf::width(), Framebuf::height());
+        }
+        LogInfo("SPI %u Hz: %u corrupted lines", (unsigned int)nActual, (unsigned int)nBadLines);
+        if (nBadLines != 0)
+        {
+            break; // a faster speed passing by chance is no safer
+        }
+        nCeiling = nActual;
+    }
+
+    spi_set_baudrate(m_spi, nOriginalSpeed);
+    return nCeiling;
+}
+
+// TE interrupt handler, shared GPIO IRQ so only acknowledge our own pin
+void ILI_TFT::on_te_irq()
+{
+    if (gpio_get_irq_event_mask(sm_nTEPin) & GPIO_IRQ_EDGE_RISE)
+    {
+        gpio_acknowledge_irq(sm_nTEPin, GPIO_IRQ_EDGE_RISE);
+        const uint64_t now = time_us_64();
+        if (sm_nLastVBlankUs != 0)
+        {
+            sm_nRefreshUs = static_cast<uint32_t>(now - sm_nLastVBlankUs);
+        }
+        sm_nLastVBlankUs = now;
+        sm_nVBlankCount += 1;
+    }
+}
+
 void ILI_TFT::writeByte(uint8_t data)
 {
     spi_write_blocking(m_spi, &data, 1);
@@ -620,5 +972,35 @@ void ILI_TFT::writeBlock(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uin
     writeCmd(_PASET, pBuffer, 4);
 
     writeCmd(_RAMWR);
-    sendData(data, dataLen);
+    if (data != NULL)
+    {
+        sendData(data, dataLen);
+    }
+}
+
+void ILI_TFT::readBlock(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t* data, size_t dataLen)
+{
+    uint16_t buffer[2];
+    uint8_t* pBuffer = reinterpret_cast<uint8_t*>(buffer);
+
+    buffer[0] = __builtin_bswap16(x0);
+    buffer[1] = __builtin_bswap16(x1);
+
+    writeCmd(_CASET, pBuffer, 4);
+
+    buffer[0] = __builtin_bswap16(y0);
+    buffer[1] = __builtin_bswap16(y1);
+
+    writeCmd(_PASET, pBuffer, 4);
+
+    // CS must stay asserted from the command through the read data
+    uint8_t cmd = _RAMRD;
+    uint8_t dummy;
+    cs_select();
+    command_select();
+    spi_write_blocking(m_spi, &cmd, 1);
+    data_select();
+    spi_read_blocking(m_spi, 0, &dummy, 1); // dummy read cycle
+    spi_read_blocking(m_spi, 0, data, dataLen);
+    cs_deselect();
 }
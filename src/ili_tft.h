@@ -52,16 +52,21 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <list>
 #include <memory>
+#include <vector>
 #include <pico/stdlib.h>
 #include <hardware/spi.h>
 #include <hardware/gpio.h>
+#include <hardware/pwm.h>
 #include "framebuf.h"
 #include "font.h"
 
 // ILI TFT commands
 //
 #define _RDDSDR         0x0f // Read Display Self-Diagnostic Result
+#define _SLPIN          0x10 // Sleep In
 #define _SLPOUT         0x11 // Sleep Out
+#define _PTLON          0x12 // Partial Mode On
+#define _NORON          0x13 // Normal Display Mode On
 #define _GAMSET         0x26 // Gamma Set
 #define _DISPOFF        0x28 // Display Off
 #define _DISPON         0x29 // Display On
@@ -69,8 +74,14 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define _PASET          0x2b // Page Address Set
 #define _RAMWR          0x2c // Memory Write
 #define _RAMRD          0x2e // Memory Read
+#define _PTLAR          0x30 // Partial Area
+#define _VSCRDEF        0x33 // Vertical Scrolling Definition
+#define _TEOFF          0x34 // Tearing Effect Line Off
+#define _TEON           0x35 // Tearing Effect Line On
 #define _MADCTL         0x36 // Memory Access Control
 #define _VSCRSADD       0x37 // Vertical Scrolling Start Address
+#define _IDMOFF         0x38 // Idle Mode Off
+#define _IDMON          0x39 // Idle Mode On
 #define _COLMOD         0x3a // Pixel Color Mode Set
 #define _PWCTRLA        0xcb // Power Control A
 #define _PWCRTLB        0xcf // Power Control B
@@ -178,6 +189,69 @@ public:
     std::list<QUADRANT> GetQuadrants();
     void Show();
     void Show(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+    void Blit(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t dispX, uint16_t dispY); // framebuf region to display position
+
+    // Hardware vertical scrolling.  The controller scrolls along the panel's native rows, which
+    // is only the viewer's vertical axis when the rotation does not swap rows/columns (MADCTL_MV).
+    // Fixed areas and offsets are given in viewer coordinates; a row R of the scroll area is
+    // displayed from row topFixed + (R + offset) % ScrollHeight() of the display address space.
+    bool CanScrollVertically() const
+    {
+        return (m_madctl & MADCTL_MV) == 0;
+    }
+    void SetScrollArea(uint16_t topFixed, uint16_t bottomFixed);
+    void SetScrollOffset(uint16_t offset);
+    void ResetScroll();
+    uint16_t ScrollHeight() const
+    {
+        return m_scrollHeight;
+    }
+
+    // Tearing-effect synchronization.  With a TE pin connected, the first Show() of each frame
+    // (started by BeginFrame()) waits for vertical blanking, but only if the blit can be written
+    // within one refresh period, timed from the TE edges, at the current SPI speed.  Anything
+    // larger is overtaken by the panel scan and tears regardless: at 40MHz a full 480x320 RGB565
+    // screen takes about four refresh periods.  So this reduces tearing; it does not remove it.
+    void EnableTearingSync(uint pin);
+    void DisableTearingSync();
+    bool WaitForVBlank(uint32_t timeoutUs = 50000);
+    void BeginFrame()
+    {
+        m_bFrameSynced = false;
+    }
+
+    // Frame pacing: WaitForNextFrame() blocks until the next frame slot, and returns false (and
+    // counts a missed frame) if the previous frame overran its slot.  An interval of 0 disables pacing.
+    void SetFrameInterval(uint32_t intervalUs);
+    bool WaitForNextFrame();
+    uint32_t MissedFrames() const
+    {
+        return m_nMissedFrames;
+    }
+
+    // Power management.  Idle mode reduces the panel to 8 colours (MSB of each component).
+    // The partial area, like scrolling, runs along the panel's native rows: viewer rows in
+    // portrait rotations, viewer columns in landscape ones.  NormalMode() leaves partial mode.
+    void Sleep(bool bSleep);
+    void SetIdleMode(bool bIdle);
+    void SetPartialArea(uint16_t start, uint16_t end);
+    void NormalMode();
+    void SetBacklightPin(uint pin);
+    void SetBacklight(uint8_t percent);
+    bool IsSleeping() const
+    {
+        return m_bSleeping;
+    }
+
+    // Diagnostics.  Requires the panel's SDO to be wired to MISO.  Verify() reads back (RAMRD, at a
+    // conservative SPI speed) the display area covered by a framebuf region and compares it with the
+    // framebuf, returning the number of mismatched lines (framebuf rows listed in pBadLines if given);
+    // an empty region, or one outside the framebuf, reads nothing and returns 0.
+    // MeasureSpiCeiling() blits a test pattern at each candidate write speed, in the ascending order
+    // vSpeeds must list them, and returns the last speed before the first that corrupted any line,
+    // or 0 if the slowest did; the original speed is restored.
+    uint32_t Verify(uint16_t x, uint16_t y, uint16_t w, uint16_t h, std::vector<uint16_t>* pBadLines = nullptr);
+    uint32_t MeasureSpiCeiling(const std::vector<uint32_t>& vSpeeds);
 
     void SetPixel(int x, int y, uint16_t color);
     uint16_t GetPixel(int x, int y);
@@ -243,10 +317,11 @@ protected:
     virtual void sendData(uint8_t data) = 0;
 
     void writeByte(uint8_t data);
-    void writeCmd(uint8_t cmd, uint8_t* data = NULL, size_t dataLen = 0);
+    virtual void writeCmd(uint8_t cmd, uint8_t* data = NULL, size_t dataLen = 0);
     void sendData(uint8_t* data, size_t dataLen = 0);
     virtual void sendFramebufferData(uint8_t* data, size_t dataLen = 0);
     void writeBlock(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t* data = NULL, size_t dataLen = 0);
+    void readBlock(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t* data, size_t dataLen);
 
     inline void cs_select()
     {
@@ -272,6 +347,7 @@ protected:
     uint8_t m_rst;
     uint16_t m_dispWidth;
     uint16_t m_dispHeight;
+    uint16_t m_hwHeight;
     ROTATION m_rotation;
     uint8_t m_madctl;
     uint8_t m_colmod;
@@ -280,6 +356,23 @@ protected:
     QUADRANT m_eQuadrant;
     uint16_t m_xoff;
     uint16_t m_yoff;
+    uint16_t m_scrollTop;
+    uint16_t m_scrollHeight;
+    bool m_bTearingSync;
+    bool m_bFrameSynced; // this frame has had its wait for V-blank
+    uint32_t m_nFrameIntervalUs;
+    uint64_t m_nNextFrameUs;
+    uint32_t m_nMissedFrames;
+    bool m_bSleeping;
+    int m_nBacklightPin; // -1 if not PWM controlled
+
+    // TE interrupt state
+    static uint sm_nTEPin;
+    static volatile uint32_t sm_nVBlankCount;
+    static volatile uint64_t sm_nLastVBlankUs;
+    static volatile uint32_t sm_nRefreshUs; // time between the last two TE edges
+    static void on_te_irq();
+    bool blitFitsRefresh(uint16_t w, uint16_t h) const;
 };
 
 // ILI934X-specific TFT class
@@ -0,0 +1,100 @@
+/*
+ * Asynchronous log buffer drained outside the parse loop
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "log_ring.h"
+
+#if defined(LOG_DRAIN_CORE1)
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#endif
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE must be a power of two");
+
+char LogRing::sm_szBuffer[LOG_RING_SIZE];
+std::atomic<uint32_t> LogRing::sm_iHead{0};
+std::atomic<uint32_t> LogRing::sm_iTail{0};
+std::atomic<uint32_t> LogRing::sm_nDropped{0};
+std::atomic<bool> LogRing::sm_bStarted{false};
+uint32_t LogRing::sm_nDroppedReported = 0;
+
+void LogRing::Start()
+{
+    sm_bStarted.store(true, std::memory_order_release);
+}
+
+bool LogRing::Put(const char* pLine, size_t nLen)
+{
+    if (!sm_bStarted.load(std::memory_order_relaxed))
+    {
+        std::fwrite(pLine, 1, nLen, stdout);
+        return true;
+    }
+
+    const uint32_t iHead = sm_iHead.load(std::memory_order_relaxed);
+    const uint32_t iTail = sm_iTail.load(std::memory_order_acquire);
+    if (nLen > LOG_RING_SIZE - (iHead - iTail))
+    {
+        // Only the producer writes the count, so no read-modify-write (a libcall on the M0+)
+        sm_nDropped.store(sm_nDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const size_t iStart = iHead & (LOG_RING_SIZE - 1);
+    const size_t nFirst = std::min(nLen, LOG_RING_SIZE - iStart);
+    std::memcpy(sm_szBuffer + iStart, pLine, nFirst);
+    std::memcpy(sm_szBuffer, pLine + nFirst, nLen - nFirst);
+    sm_iHead.store(iHead + static_cast<uint32_t>(nLen), std::memory_order_release);
+    return true;
+}
+
+size_t LogRing::Drain(size_t nMaxBytes)
+{
+    const uint32_t iTail = sm_iTail.load(std::memory_order_relaxed);
+    const uint32_t iHead = sm_iHead.load(std::memory_order_acquire);
+
+    const size_t nAvail = std::min(static_cast<size_t>(iHead - iTail), nMaxBytes);
+    const size_t iStart = iTail & (LOG_RING_SIZE - 1);
+    const size_t nFirst = std::min(nAvail, LOG_RING_SIZE - iStart);
+    if (nAvail > 0)
+    {
+        std::fwrite(sm_szBuffer + iStart, 1, nFirst, stdout);
+        std::fwrite(sm_szBuffer, 1, nAvail - nFirst, stdout);
+        sm_iTail.store(iTail + static_cast<uint32_t>(nAvail), std::memory_order_release);
+    }
+
+    // Report drops once the backlog has cleared, so the note lands between whole lines
+    const uint32_t nDropped = sm_nDropped.load(std::memory_order_relaxed);
+    if (nDropped != sm_nDroppedReported && iTail + nAvail == iHead)
+    {
+        std::printf("[log] %u lines dropped\n", static_cast<unsigned int>(nDropped - sm_nDroppedReported));
+        sm_nDroppedReported = nDropped;
+    }
+    return nAvail;
+}
+
+#if defined(LOG_DRAIN_CORE1)
+static void core1_drain()
+{
+    while (true)
+    {
+        if (LogRing::Drain() == 0)
+        {
+            sleep_ms(1);
+        }
+    }
+}
+
+void LogRing::LaunchCore1Drain()
+{
+    multicore_launch_core1(core1_drain);
+    Start();
+}
+#endif
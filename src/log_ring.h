@@ -0,0 +1,48 @@
+/*
+ * Asynchronous log buffer drained outside the parse loop
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+auto constexpr LOG_RING_SIZE = 4096; // Must be a power of two
+
+// LogRing class
+//
+// Single-producer, single-consumer byte ring for formatted log lines.  Put() copies
+// a whole line in or drops it (counting the drop) when the host has not kept up, so
+// the caller never waits on stdio.  Drain() writes out what is buffered and may run
+// on the other core.  Producers must not log from interrupt handlers.
+//
+// Until Start() is called, when something is about to drain the ring, Put() writes the
+// line to stdout itself; start-up logs more than the ring holds before anything drains.
+//
+class LogRing
+{
+public:
+    static void Start();
+    static bool Put(const char* pLine, size_t nLen);
+    static size_t Drain(size_t nMaxBytes = LOG_RING_SIZE);
+    static uint32_t Dropped()
+    {
+        return sm_nDropped.load(std::memory_order_relaxed);
+    }
+
+#if defined(LOG_DRAIN_CORE1)
+    static void LaunchCore1Drain();
+#endif
+
+private:
+    static char sm_szBuffer[LOG_RING_SIZE];
+    static std::atomic<uint32_t> sm_iHead; // free-running write index, producer only
+    static std::atomic<uint32_t> sm_iTail; // free-running read index, consumer only
+    static std::atomic<uint32_t> sm_nDropped; // producer only
+    static std::atomic<bool> sm_bStarted;
+    static uint32_t sm_nDroppedReported;
+};
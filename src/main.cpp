@@ -31,6 +31,7 @@
 #include "gps_tft.h"
 #include "font_factory.h"
 #include "timemgr.h"
+#include "log_ring.h"
 
 #define UART0_DEVICE uart0                    // Default is uart0
 #define PIN_UART0_TX PICO_DEFAULT_UART_TX_PIN // Default is 0
@@ -113,6 +114,9 @@ void SplashDemo(ILI_TFT::Shared spDisplay);
 int main()
 {
     stdio_usb_init();
+#if defined(LOG_ASYNC) && defined(LOG_DRAIN_CORE1)
+    LogRing::LaunchCore1Drain();
+#endif
     adc_init();
 
 #if !defined(NDEBUG)
@@ -148,13 +152,6 @@ int main()
     gpio_init(PIN_RST);
     gpio_set_dir(PIN_RST, GPIO_OUT);
 
-// Enable display. Can also just tie the display enable line to 3v3.
-#if defined(PIN_BL)
-    gpio_init(PIN_BL);
-    gpio_set_dir(PIN_BL, GPIO_OUT);
-    gpio_put(PIN_BL, 0); // backlight off until display initialized
-#endif
-
 #if defined(SEEED_XIAO_RP2040)
     // Clear LED(s) on XIAO (default on)
     LED_pico ledBlue(25);  // blue
@@ -205,10 +202,30 @@ int main()
 #error Unsupported display specified
 #endif
 
+// Enable display. Can also just tie the display enable line to 3v3.
+#if defined(PIN_BL)
+    spDisplay->SetBacklightPin(PIN_BL); // backlight off until display initialized
+#endif
+
     spDisplay->Reset();
     spDisplay->Initialize();
+#if defined(DISPLAY_TE_PIN)
+    spDisplay->EnableTearingSync(DISPLAY_TE_PIN);
+#endif
+#if defined(DISPLAY_FRAME_INTERVAL_MS)
+    spDisplay->SetFrameInterval(DISPLAY_FRAME_INTERVAL_MS * 1000);
+#endif
+#if defined(DISPLAY_SPI_VERIFY)
+    // Characterize the fastest write speed that reads back cleanly, and run at it
+    uint32_t nSpiCeiling = spDisplay->MeasureSpiCeiling({10000000, 20000000, 31250000, 40000000, 62500000});
+    LogInfo("Measured SPI ceiling: %u Hz", (unsigned int)nSpiCeiling);
+    if (nSpiCeiling != 0)
+    {
+        spi_set_baudrate(SPI_DEVICE, nSpiCeiling);
+    }
+#endif
     spDisplay->Clear(COLOUR_BLACK);
-    gpio_put(PIN_BL, 1);
+    spDisplay->SetBacklight(100);
 
 #if !defined(NDEBUG)
     SplashDemo(spDisplay);
@@ -216,6 +233,34 @@ int main()
 #endif
 
     TimeMgr::Shared spTimeMgr = std::make_shared<TimeMgr>(TIME_ZONE);
+#if defined(GPS_PPS_PIN)
+    spTimeMgr->EnablePps(GPS_PPS_PIN);
+#endif
+
+#if defined(GPS_EPOCH_TRIGGER)
+    spGPS->SetEpochTrigger(EpochTrigger::GPS_EPOCH_TRIGGER);
+#endif
+    GpsConfig::Options gpsOptions;
+    gpsOptions.nInitialBaud = UART_BAUD_RATE;
+#if defined(GPS_RECEIVER_UBLOX)
+    gpsOptions.receiver = GpsConfig::Receiver::Ublox;
+#endif
+#if defined(GPS_CONFIG_BAUD)
+    gpsOptions.nBaud = GPS_CONFIG_BAUD;
+#endif
+#if defined(GPS_CONFIG_RATE_HZ)
+    gpsOptions.nRateHz = GPS_CONFIG_RATE_HZ;
+#endif
+#if defined(GPS_CONFIG_SENTENCES)
+    gpsOptions.bSentenceMask = true;
+#endif
+#if defined(GPS_CONFIG_UBX_NAV)
+    gpsOptions.bUbxNav = true;
+#endif
+    spGPS->Configure(gpsOptions);
+#if defined(GPS_AUTOBAUD)
+    spGPS->SetAutobaud(true);
+#endif
 
     // Create the GPS_TFT display object
     GPS_TFT::Shared spDevice = std::make_shared<GPS_TFT>(spDisplay, spGPS, spLED, spTimeMgr);
@@ -230,6 +275,11 @@ int main()
 #endif
 
     LogInfo("Exiting...");
+#if defined(LOG_ASYNC) && !defined(LOG_DRAIN_CORE1)
+    while (LogRing::Drain() != 0)
+    {
+    }
+#endif
     return 0;
 }
 
@@ -0,0 +1,102 @@
+/*
+ * Scrolling text console using the display's hardware vertical scrolling
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#include <algorithm>
+
+#include "scroll_console.h"
+#include "timemgr.h"
+
+ScrollConsole::ScrollConsole(ILI_TFT::Shared spDisplay, uint16_t topFixed, uint16_t bottomFixed)
+    : m_spDisplay(spDisplay),
+      m_nTopFixed(topFixed),
+      m_nBottomFixed(bottomFixed),
+      m_nLineHeight(0),
+      m_nLines(0),
+      m_nOffset(0),
+      m_bgColour(COLOUR_BLACK),
+      m_bActive(false)
+{
+}
+
+ScrollConsole::~ScrollConsole()
+{
+    End();
+}
+
+bool ScrollConsole::Begin(uint16_t bgColour)
+{
+    if (!m_spDisplay->CanScrollVertically())
+    {
+        LogWarn("Scroll console requires a portrait rotation");
+        return false;
+    }
+
+    const BitmapFont* pFont = m_spDisplay->GetFont();
+    m_nLineHeight           = pFont ? pFont->effectiveLineAdvance() : 8;
+    if (m_nLineHeight > m_spDisplay->height() || m_nTopFixed + m_nBottomFixed + m_nLineHeight > m_spDisplay->Height())
+    {
+        return false;
+    }
+
+    // Size the scroll area to a whole number of lines so a line never wraps around it
+    uint16_t nScroll = m_spDisplay->Height() - m_nTopFixed - m_nBottomFixed;
+    m_spDisplay->SetScrollArea(m_nTopFixed, m_nBottomFixed + nScroll % m_nLineHeight);
+
+    m_bgColour = bgColour;
+    m_nLines   = 0;
+    m_nOffset  = 0;
+    m_bActive  = true;
+    for (uint16_t y = 0; y < m_spDisplay->ScrollHeight(); y += m_nLineHeight)
+    {
+        drawLine("", m_bgColour, m_nTopFixed + y);
+    }
+    return true;
+}
+
+void ScrollConsole::End()
+{
+    if (m_bActive)
+    {
+        m_spDisplay->ResetScroll();
+        m_bActive = false;
+    }
+}
+
+void ScrollConsole::AddLine(const std::string& strLine, uint16_t colour)
+{
+    if (!m_bActive)
+    {
+        return;
+    }
+
+    uint16_t nScroll = m_spDisplay->ScrollHeight();
+    if (m_nLines < nScroll / m_nLineHeight)
+    {
+        // Still filling the area top to bottom
+        drawLine(strLine, colour, m_nTopFixed + m_nLines * m_nLineHeight);
+        ++m_nLines;
+        return;
+    }
+
+    // Overwrite the oldest (top) line, then scroll it to the bottom
+    drawLine(strLine, colour, m_nTopFixed + m_nOffset);
+    m_nOffset = (m_nOffset + m_nLineHeight) % nScroll;
+    m_spDisplay->SetScrollOffset(m_nOffset);
+}
+
+void ScrollConsole::drawLine(const std::string& strLine, uint16_t colour, uint16_t dispY)
+{
+    // The framebuf may be narrower than the display, so render and blit in vertical strips
+    uint16_t nStripWidth = m_spDisplay->width();
+    for (uint16_t x = 0; x < m_spDisplay->Width(); x += nStripWidth)
+    {
+        uint16_t w = std::min<uint16_t>(nStripWidth, m_spDisplay->Width() - x);
+        m_spDisplay->fillrect(0, 0, w, m_nLineHeight, m_bgColour);
+        m_spDisplay->text(strLine.c_str(), -static_cast<int>(x), 0, colour);
+        m_spDisplay->Blit(0, 0, w, m_nLineHeight, x, dispY);
+    }
+}
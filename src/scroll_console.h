@@ -0,0 +1,49 @@
+/*
+ * Scrolling text console using the display's hardware vertical scrolling
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "ili_tft.h"
+
+// ScrollConsole class
+//
+// Appends lines of text to a region of the display.  Once the region is full the
+// controller's scroll start address is advanced by one line, so each new line costs
+// a single line-high blit rather than a redraw of the whole region.  Requires a
+// rotation in which the panel's native rows are the viewer's rows (portrait).
+//
+class ScrollConsole
+{
+public:
+    typedef std::shared_ptr<ScrollConsole> Shared;
+
+    ScrollConsole(ILI_TFT::Shared spDisplay, uint16_t topFixed = 0, uint16_t bottomFixed = 0);
+    ~ScrollConsole();
+
+    bool Begin(uint16_t bgColour = COLOUR_BLACK);
+    void End();
+    void AddLine(const std::string& strLine, uint16_t colour = COLOUR_WHITE);
+    bool IsActive() const
+    {
+        return m_bActive;
+    }
+
+private:
+    void drawLine(const std::string& strLine, uint16_t colour, uint16_t dispY);
+
+    ILI_TFT::Shared m_spDisplay;
+    uint16_t m_nTopFixed;
+    uint16_t m_nBottomFixed;
+    uint16_t m_nLineHeight;
+    uint16_t m_nLines;  // lines written until the scroll area first fills
+    uint16_t m_nOffset; // current hardware scroll offset in rows
+    uint16_t m_bgColour;
+    bool m_bActive;
+};
@@ -6,6 +6,7 @@
  */
 
 #include "timemgr.h"
+#include "log_ring.h"
 
 #include <algorithm>
 #include <array>
@@ -13,13 +14,14 @@
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include <limits>
+#include <cstdio>
 #include <sys/time.h>
 
 #include "pico/stdlib.h"
 #include "pico/aon_timer.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
 
 #ifndef TIMEMGR_ENABLE_NTP
 #define TIMEMGR_ENABLE_NTP 0
@@ -43,21 +45,38 @@
 
 namespace
 {
-    constexpr uint64_t validEpochThresholdSec = 1700000000ULL;
+    // An RMC is paired with the latest PPS edge no more than this before it was parsed
+    constexpr uint64_t ppsPairWindowUs = 1000000;
+    // Drift is measured over at least this many seconds, and implausible values discarded.  Whole-second
+    // RMC time carries tens of milliseconds of latency jitter, so it needs a much longer baseline than PPS.
+    constexpr int64_t ppsDriftWindowSec = 64;
+    constexpr int64_t gpsDriftWindowSec = 3600;
+    constexpr double maxDriftPpm        = 500.0;
+
+    // Holdover: drift correction starts once the time source has been missing this long, and is reapplied at most this often
+    constexpr uint64_t holdoverAfterUs    = 3 * 1000 * 1000;
+    constexpr uint64_t holdoverIntervalUs = 1000 * 1000;
+
+    // Error of the time at the moment it was set, by source
+    constexpr uint64_t ppsSyncErrorUs = 10;
+    constexpr uint64_t gpsSyncErrorUs = 1000 * 1000; // RMC arrives up to a second after the second it names
+
+    // Oscillator error assumed before a drift estimate exists, and the floor on an estimate's uncertainty
+    constexpr double uncalibratedDriftPpm = 50.0;
+    constexpr double minDriftErrorPpm     = 0.5;
 
 #if TIMEMGR_ENABLE_NTP
     constexpr uint32_t ntpPort              = 123;
     constexpr uint32_t ntpPacketSize        = 48;
     constexpr uint64_t ntpEpochDeltaSeconds = 2208988800ULL;
-#endif
 
-    enum class DstRule
-    {
-        None,
-        NorthernHemisphere,
-        European,
-        SouthernHemisphere,
-    };
+    // Queried together each round; the reply with the shortest round trip wins
+    constexpr const char* ntpServers[]   = {"0.pool.ntp.org", "1.pool.ntp.org", "2.pool.ntp.org", "time.google.com"};
+    constexpr size_t ntpServerCount      = sizeof(ntpServers) / sizeof(ntpServers[0]);
+    constexpr uint64_t ntpRoundTimeoutUs = 5 * 1000 * 1000;
+    constexpr uint64_t ntpRetryUs        = 60ULL * 1000 * 1000;
+    constexpr uint64_t ntpResyncUs       = 60ULL * 60 * 1000 * 1000;
+#endif
 
     enum class DstOverride
     {
@@ -66,140 +85,232 @@ namespace
         On,
     };
 
-    std::string trim_copy(const std::string& value)
+    struct TimeZoneRule
     {
-        const auto begin = std::find_if_not(value.begin(), value.end(), [](unsigned char ch) {
-            return std::isspace(ch) != 0;
-        });
-        const auto end   = std::find_if_not(value.rbegin(), value.rend(), [](unsigned char ch) {
-                             return std::isspace(ch) != 0;
-                         }).base();
-        return (begin >= end) ? std::string() : std::string(begin, end);
-    }
+        const char* name;  // lower case
+        const char* posix; // POSIX TZ rule, as in the footer of the tzdata zone file
+    };
 
-    std::string to_lower_copy(std::string value)
+    // Zone names are matched case-insensitively
+    constexpr TimeZoneRule timeZoneRules[] = {
+        {"america/new_york",               "EST5EDT,M3.2.0,M11.1.0"},
+        {"america/toronto",                "EST5EDT,M3.2.0,M11.1.0"},
+        {"america/detroit",                "EST5EDT,M3.2.0,M11.1.0"},
+        {"america/indiana/indianapolis",   "EST5EDT,M3.2.0,M11.1.0"},
+        {"america/halifax",                "AST4ADT,M3.2.0,M11.1.0"},
+        {"america/st_johns",               "NST3:30NDT,M3.2.0,M11.1.0"},
+        {"america/chicago",                "CST6CDT,M3.2.0,M11.1.0"},
+        {"america/winnipeg",               "CST6CDT,M3.2.0,M11.1.0"},
+        {"america/denver",                 "MST7MDT,M3.2.0,M11.1.0"},
+        {"america/edmonton",               "MST7MDT,M3.2.0,M11.1.0"},
+        {"america/boise",                  "MST7MDT,M3.2.0,M11.1.0"},
+        {"america/los_angeles",            "PST8PDT,M3.2.0,M11.1.0"},
+        {"america/vancouver",              "PST8PDT,M3.2.0,M11.1.0"},
+        {"america/anchorage",              "AKST9AKDT,M3.2.0,M11.1.0"},
+        {"america/havana",                 "CST5CDT,M3.2.0/0,M11.1.0/1"},
+        {"america/santiago",               "<-04>4<-03>,M9.1.6/24,M4.1.6/24"},
+        {"america/phoenix",                "MST7"},
+        {"america/regina",                 "CST6"},
+        {"america/mexico_city",            "CST6"},
+        {"america/puerto_rico",            "AST4"},
+        {"america/bogota",                 "<-05>5"},
+        {"america/lima",                   "<-05>5"},
+        {"america/caracas",                "<-04>4"},
+        {"america/sao_paulo",              "<-03>3"},
+        {"america/argentina/buenos_aires", "<-03>3"},
+        {"pacific/honolulu",               "HST10"},
+        {"europe/london",                  "GMT0BST,M3.5.0/1,M10.5.0"},
+        {"europe/dublin",                  "GMT0IST,M3.5.0/1,M10.5.0"},
+        {"europe/ireland",                 "GMT0IST,M3.5.0/1,M10.5.0"},
+        {"europe/lisbon",                  "WET0WEST,M3.5.0/1,M10.5.0"},
+        {"atlantic/canary",                "WET0WEST,M3.5.0/1,M10.5.0"},
+        {"europe/paris",                   "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/berlin",                  "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/amsterdam",               "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/brussels",                "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/rome",                    "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/madrid",                  "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/vienna",                  "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/zurich",                  "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/stockholm",               "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/oslo",                    "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/copenhagen",              "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/prague",                  "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/warsaw",                  "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/budapest",                "CET-1CEST,M3.5.0,M10.5.0/3"},
+        {"europe/athens",                  "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/helsinki",                "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/kyiv",                    "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/kiev",                    "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/bucharest",               "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/sofia",                   "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/riga",                    "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/vilnius",                 "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/tallinn",                 "EET-2EEST,M3.5.0/3,M10.5.0/4"},
+        {"europe/istanbul",                "<+03>-3"},
+        {"europe/moscow",                  "MSK-3"},
+        {"africa/lagos",                   "WAT-1"},
+        {"africa/cairo",                   "EET-2EEST,M4.5.5/0,M10.5.4/24"},
+        {"africa/johannesburg",            "SAST-2"},
+        {"africa/nairobi",                 "EAT-3"},
+        {"asia/jerusalem",                 "IST-2IDT,M3.4.4/26,M10.5.0"},
+        {"asia/tehran",                    "<+0330>-3:30"},
+        {"asia/dubai",                     "<+04>-4"},
+        {"asia/karachi",                   "PKT-5"},
+        {"asia/kolkata",                   "IST-5:30"},
+        {"asia/kathmandu",                 "<+0545>-5:45"},
+        {"asia/dhaka",                     "<+06>-6"},
+        {"asia/bangkok",                   "<+07>-7"},
+        {"asia/jakarta",                   "WIB-7"},
+        {"asia/ho_chi_minh",               "<+07>-7"},
+        {"asia/shanghai",                  "CST-8"},
+        {"asia/hong_kong",                 "HKT-8"},
+        {"asia/singapore",                 "<+08>-8"},
+        {"asia/taipei",                    "CST-8"},
+        {"asia/manila",                    "PST-8"},
+        {"australia/perth",                "AWST-8"},
+        {"asia/tokyo",                     "JST-9"},
+        {"asia/seoul",                     "KST-9"},
+        {"australia/darwin",               "ACST-9:30"},
+        {"australia/adelaide",             "ACST-9:30ACDT,M10.1.0,M4.1.0/3"},
+        {"australia/brisbane",             "AEST-10"},
+        {"australia/sydney",               "AEST-10AEDT,M10.1.0,M4.1.0/3"},
+        {"australia/melbourne",            "AEST-10AEDT,M10.1.0,M4.1.0/3"},
+        {"australia/hobart",               "AEST-10AEDT,M10.1.0,M4.1.0/3"},
+        {"pacific/auckland",               "NZST-12NZDT,M9.5.0,M4.1.0/3"},
+    };
+    constexpr size_t numTimeZoneRules = sizeof(timeZoneRules) / sizeof(timeZoneRules[0]);
+
+    constexpr char ascii_lower(char ch)
     {
-        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) {
-            return static_cast<char>(std::tolower(ch));
-        });
-        return value;
+        return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
     }
 
-    int day_of_week(int year, int month, int day)
+    // FNV-1a over the lower-cased name, seeded so a collision-free seed can be searched for
+    constexpr uint32_t zone_hash(const char* name, size_t length, uint32_t seed)
     {
-        static const int t[] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
-        year -= (month < 3);
-        return (year + year / 4 - year / 100 + year / 400 + t[month - 1] + day) % 7;
+        uint32_t hash = 2166136261u ^ seed;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<uint8_t>(ascii_lower(name[i]));
+            hash *= 16777619u;
+        }
+        return hash;
     }
 
-    int nth_sunday_day(int year, int month, int nth)
+    constexpr size_t const_strlen(const char* text)
     {
-        const int first_day = 1 + ((7 + (0 - day_of_week(year, month, 1))) % 7);
-        return first_day + (nth - 1) * 7;
+        size_t length = 0;
+        while (text[length] != '\0')
+        {
+            ++length;
+        }
+        return length;
     }
 
-    int last_sunday_day(int year, int month)
+    constexpr size_t zoneSlots = 1024; // power of two, sparse enough that a collision-free seed is found quickly
+    static_assert(numTimeZoneRules < 255, "zone index must fit in uint8_t");
+
+    constexpr bool seed_is_perfect(uint32_t seed)
     {
-        const int last_day = 31;
-        for (int day = last_day; day >= 1; --day)
+        std::array<bool, zoneSlots> used{};
+        for (size_t i = 0; i < numTimeZoneRules; ++i)
         {
-            if (day_of_week(year, month, day) == 0)
+            const size_t slot = zone_hash(timeZoneRules[i].name, const_strlen(timeZoneRules[i].name), seed) & (zoneSlots - 1);
+            if (used[slot])
             {
-                return day;
+                return false;
             }
+            used[slot] = true;
         }
-        return 1;
+        return true;
     }
 
-    DstOverride parse_dst_override()
+    constexpr uint32_t find_perfect_seed()
     {
-        const std::string value = to_lower_copy(STRINGIFY(USE_DST));
-        if (value == "yes" || value == "on" || value == "true")
-        {
-            return DstOverride::On;
-        }
-        if (value == "no" || value == "off" || value == "false")
+        for (uint32_t seed = 0; seed < 10000; ++seed)
         {
-            return DstOverride::Off;
+            if (seed_is_perfect(seed))
+            {
+                return seed;
+            }
         }
-        return DstOverride::Automatic;
+        return UINT32_MAX;
     }
 
-    bool is_dst_active(std::time_t whenUtc, DstRule rule)
+    constexpr uint32_t zoneHashSeed = find_perfect_seed();
+    static_assert(zoneHashSeed != UINT32_MAX, "no collision-free seed for the time zone table");
+
+    // Slot -> rule index + 1 (0 = empty)
+    constexpr std::array<uint8_t, zoneSlots> build_zone_slots()
     {
-        std::tm utcTm{};
-        if (gmtime_r(&whenUtc, &utcTm) == nullptr)
+        std::array<uint8_t, zoneSlots> slots{};
+        for (size_t i = 0; i < numTimeZoneRules; ++i)
         {
-            return false;
+            slots[zone_hash(timeZoneRules[i].name, const_strlen(timeZoneRules[i].name), zoneHashSeed) & (zoneSlots - 1)] =
+                static_cast<uint8_t>(i + 1);
         }
+        return slots;
+    }
 
-        const int year  = utcTm.tm_year + 1900;
-        const int month = utcTm.tm_mon + 1;
-        const int day   = utcTm.tm_mday;
+    constexpr std::array<uint8_t, zoneSlots> zoneSlotTable = build_zone_slots();
 
-        switch (rule)
+    const TimeZoneRule* find_time_zone(const char* name, size_t length)
+    {
+        const uint8_t entry = zoneSlotTable[zone_hash(name, length, zoneHashSeed) & (zoneSlots - 1)];
+        if (entry == 0)
         {
-        case DstRule::NorthernHemisphere:
-            if (month < 3 || month > 11)
-            {
-                return false;
-            }
-            if (month > 3 && month < 11)
-            {
-                return true;
-            }
-            if (month == 3)
+            return nullptr;
+        }
+        const TimeZoneRule& rule = timeZoneRules[entry - 1];
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (rule.name[i] != ascii_lower(name[i]))
             {
-                return day >= nth_sunday_day(year, 3, 2);
+                return nullptr;
             }
-            return day < nth_sunday_day(year, 11, 1);
+        }
+        return rule.name[length] == '\0' ? &rule : nullptr;
+    }
 
-        case DstRule::European:
-            if (month < 3 || month > 10)
-            {
-                return false;
-            }
-            if (month > 3 && month < 10)
-            {
-                return true;
-            }
-            if (month == 3)
-            {
-                return day >= last_sunday_day(year, 3);
-            }
-            return day < last_sunday_day(year, 10);
+    std::string trim_copy(const std::string& value)
+    {
+        const auto begin = std::find_if_not(value.begin(), value.end(), [](unsigned char ch) {
+            return std::isspace(ch) != 0;
+        });
+        const auto end   = std::find_if_not(value.rbegin(), value.rend(), [](unsigned char ch) {
+                             return std::isspace(ch) != 0;
+                         }).base();
+        return (begin >= end) ? std::string() : std::string(begin, end);
+    }
 
-        case DstRule::SouthernHemisphere:
-            if (month < 10 && month > 4)
-            {
-                return false;
-            }
-            if (month > 10 || month < 4)
-            {
-                return true;
-            }
-            if (month == 10)
-            {
-                return day >= nth_sunday_day(year, 10, 1);
-            }
-            return day < nth_sunday_day(year, 4, 1);
+    std::string to_lower_copy(std::string value)
+    {
+        std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) {
+            return static_cast<char>(std::tolower(ch));
+        });
+        return value;
+    }
 
-        default:
-            return false;
-        }
+    int day_of_week(int year, int month, int day)
+    {
+        static const int t[] = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
+        year -= (month < 3);
+        return (year + year / 4 - year / 100 + year / 400 + t[month - 1] + day) % 7;
     }
 
-    bool resolve_dst_for_rule(DstOverride override, std::time_t whenUtc, DstRule rule)
+    DstOverride parse_dst_override()
     {
-        if (override == DstOverride::On)
+        const std::string value = to_lower_copy(STRINGIFY(USE_DST));
+        if (value == "yes" || value == "on" || value == "true")
         {
-            return true;
+            return DstOverride::On;
         }
-        if (override == DstOverride::Off)
+        if (value == "no" || value == "off" || value == "false")
         {
-            return false;
+            return DstOverride::Off;
         }
-        return is_dst_active(whenUtc, rule);
+        return DstOverride::Automatic;
     }
 
     bool parse_numeric_offset(const std::string& text, int& totalMinutesOut)
@@ -290,48 +401,6 @@ namespace
         return true;
     }
 
-    bool parse_gprmc_time(const std::string& timeText, int& hourOut, int& minuteOut, int& secondOut)
-    {
-        unsigned int hour   = 0;
-        unsigned int minute = 0;
-        unsigned int second = 0;
-        if (!parse_fixed_unsigned(timeText, 0, 2, hour) || !parse_fixed_unsigned(timeText, 2, 2, minute) ||
-            !parse_fixed_unsigned(timeText, 4, 2, second))
-        {
-            return false;
-        }
-
-        hourOut   = static_cast<int>(hour);
-        minuteOut = static_cast<int>(minute);
-        secondOut = static_cast<int>(second);
-        return hourOut < 24 && minuteOut < 60 && secondOut < 60;
-    }
-
-    bool parse_gprmc_date(const std::string& dateText, int& yearOut, int& monthOut, int& dayOut)
-    {
-        unsigned int day   = 0;
-        unsigned int month = 0;
-        unsigned int year  = 0;
-        if (!parse_fixed_unsigned(dateText, 0, 2, day) || !parse_fixed_unsigned(dateText, 2, 2, month) ||
-            !parse_fixed_unsigned(dateText, 4, 2, year))
-        {
-            return false;
-        }
-
-        if (year >= 70)
-        {
-            yearOut = 1900 + static_cast<int>(year);
-        }
-        else
-        {
-            yearOut = 2000 + static_cast<int>(year);
-        }
-
-        monthOut = static_cast<int>(month);
-        dayOut   = static_cast<int>(day);
-        return monthOut >= 1 && monthOut <= 12 && dayOut >= 1 && dayOut <= 31;
-    }
-
     bool is_leap_year(int year)
     {
         return (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
@@ -353,7 +422,7 @@ namespace
         return day >= 1 && day <= maxDay;
     }
 
-    std::time_t utc_time_from_ymdhms(int year, int month, int day, int hour, int minute, int second)
+    constexpr std::time_t utc_time_from_ymdhms(int year, int month, int day, int hour, int minute, int second)
     {
         const int adjustedYear          = year - (month <= 2 ? 1 : 0);
         const int era                   = (adjustedYear >= 0 ? adjustedYear : adjustedYear - 399) / 400;
@@ -367,278 +436,695 @@ namespace
         return static_cast<std::time_t>(secondsSinceEpoch);
     }
 
-#if TIMEMGR_ENABLE_NTP
-    struct NtpQueryContext
+    // __DATE__ is "Mmm dd yyyy".  Nothing this firmware sees can predate its own build, which replaces
+    // a hardcoded validity threshold and anchors two digit years and GPS week rollover.
+    constexpr int build_year()
     {
-        volatile bool bDnsReady;
-        volatile bool bDnsFailed;
-        volatile bool bResponseReady;
-        volatile bool bResponseFailed;
-        ip_addr_t serverAddr;
-        uint32_t seconds1900;
-        struct udp_pcb* pUdp;
-    };
+        return (__DATE__[7] - '0') * 1000 + (__DATE__[8] - '0') * 100 + (__DATE__[9] - '0') * 10 + (__DATE__[10] - '0');
+    }
 
-    void ntp_recv_callback(void* arg, struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* addr, u16_t port)
+    constexpr int build_month()
     {
-        (void)pcb;
-        (void)addr;
-        (void)port;
-
-        auto* pCtx = static_cast<NtpQueryContext*>(arg);
-        if (pCtx == nullptr)
+        constexpr const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+        for (int i = 0; i < 12; i++)
         {
-            if (p != nullptr)
+            if (__DATE__[0] == months[i * 3] && __DATE__[1] == months[i * 3 + 1] && __DATE__[2] == months[i * 3 + 2])
             {
-                pbuf_free(p);
+                return i + 1;
             }
-            return;
         }
+        return 1;
+    }
+
+    constexpr int build_day()
+    {
+        return (__DATE__[4] == ' ' ? 0 : (__DATE__[4] - '0') * 10) + (__DATE__[5] - '0');
+    }
+
+    constexpr std::time_t buildEpochSec = utc_time_from_ymdhms(build_year(), build_month(), build_day(), 0, 0, 0) - 86400;
+
+    // GPS time started 1980-01-06 and broadcasts a 10-bit week number.  A receiver whose firmware epoch has
+    // passed reports dates 1024 weeks early; such dates fall before the build and are moved forward.
+    constexpr std::time_t gpsWeekSec         = 7 * 86400;
+    constexpr std::time_t gpsWeekRolloverSec = 1024 * gpsWeekSec;
+    constexpr int defaultGpsUtcLeapSec       = 18; // since 2017-01-01
 
-        if (p == nullptr || p->tot_len < ntpPacketSize)
+    std::time_t correct_week_rollover(std::time_t gpsUtc)
+    {
+        for (int i = 0; i < 2 && gpsUtc < buildEpochSec; i++)
         {
-            pCtx->bResponseFailed = true;
-            if (p != nullptr)
-            {
-                pbuf_free(p);
-            }
-            return;
+            gpsUtc += gpsWeekRolloverSec;
         }
+        return gpsUtc;
+    }
 
-        std::array<uint8_t, ntpPacketSize> packet{};
-        if (pbuf_copy_partial(p, packet.data(), packet.size(), 0) != ntpPacketSize)
+    bool parse_gprmc_time(const std::string& timeText, int& hourOut, int& minuteOut, int& secondOut)
+    {
+        unsigned int hour   = 0;
+        unsigned int minute = 0;
+        unsigned int second = 0;
+        if (!parse_fixed_unsigned(timeText, 0, 2, hour) || !parse_fixed_unsigned(timeText, 2, 2, minute) ||
+            !parse_fixed_unsigned(timeText, 4, 2, second))
         {
-            pCtx->bResponseFailed = true;
-            pbuf_free(p);
-            return;
+            return false;
         }
 
-        pbuf_free(p);
-        pCtx->seconds1900 = (static_cast<uint32_t>(packet[40]) << 24) | (static_cast<uint32_t>(packet[41]) << 16) |
-                            (static_cast<uint32_t>(packet[42]) << 8) | static_cast<uint32_t>(packet[43]);
-        pCtx->bResponseReady = true;
+        hourOut   = static_cast<int>(hour);
+        minuteOut = static_cast<int>(minute);
+        secondOut = static_cast<int>(second);
+        return hourOut < 24 && minuteOut < 60 && secondOut <= 60; // 60 during a leap second
     }
 
-    void ntp_dns_found_callback(const char* name, const ip_addr_t* ipaddr, void* arg)
+    // DDMMYY from RMC, or DDMMYYYY from ZDA
+    bool parse_gprmc_date(const std::string& dateText, int& yearOut, int& monthOut, int& dayOut)
     {
-        (void)name;
-        auto* pCtx = static_cast<NtpQueryContext*>(arg);
-        if (pCtx == nullptr)
+        unsigned int day   = 0;
+        unsigned int month = 0;
+        unsigned int year  = 0;
+        const size_t yearDigits = (dateText.size() >= 8) ? 4 : 2;
+        if (!parse_fixed_unsigned(dateText, 0, 2, day) || !parse_fixed_unsigned(dateText, 2, 2, month) ||
+            !parse_fixed_unsigned(dateText, 4, yearDigits, year))
         {
-            return;
+            return false;
         }
 
-        if (ipaddr == nullptr)
+        if (yearDigits == 4)
         {
-            pCtx->bDnsFailed = true;
-            return;
+            yearOut = static_cast<int>(year);
         }
-
-        pCtx->serverAddr = *ipaddr;
-        pCtx->bDnsReady  = true;
-    }
-
-    bool wait_for_flag(const volatile bool& bDoneFlag, const volatile bool& bFailFlag, uint32_t timeoutMs)
-    {
-        const absolute_time_t timeoutAt = make_timeout_time_ms(timeoutMs);
-        while (true)
+        else
         {
-            if (bDoneFlag)
-            {
-                return true;
-            }
-            if (bFailFlag)
-            {
-                return false;
-            }
-            if (absolute_time_diff_us(get_absolute_time(), timeoutAt) <= 0)
+            // Two digit years fall in a century-wide window around the build year
+            yearOut = build_year() / 100 * 100 + static_cast<int>(year);
+            if (yearOut > build_year() + 49)
             {
-                return false;
+                yearOut -= 100;
             }
-            sleep_ms(10);
         }
+
+        monthOut = static_cast<int>(month);
+        dayOut   = static_cast<int>(day);
+        return monthOut >= 1 && monthOut <= 12 && dayOut >= 1 && dayOut <= 31;
     }
-#endif
 
-    std::string format_uptime_timestamp()
+    void civil_from_epoch_days(int64_t days, int& yearOut, int& monthOut, int& dayOut)
     {
-        const uint64_t nowUs    = time_us_64();
-        const uint64_t totalMs  = nowUs / 1000;
-        const uint64_t ms       = totalMs % 1000;
-        const uint64_t totalSec = totalMs / 1000;
-        const uint64_t sec      = totalSec % 60;
-        const uint64_t min      = (totalSec / 60) % 60;
-        const uint64_t hour     = totalSec / 3600;
-
-        std::ostringstream out;
-        out << "UP " << std::setfill('0') << std::setw(2) << hour << ':' << std::setw(2) << min << ':' << std::setw(2) << sec << '.'
-            << std::setw(3) << ms;
-        return out.str();
+        days += 719468;
+        const int64_t era            = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned int dayOfEra  = static_cast<unsigned int>(days - era * 146097);
+        const unsigned int yoe       = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const unsigned int dayOfYear = dayOfEra - (365 * yoe + yoe / 4 - yoe / 100);
+        const unsigned int mp        = (5 * dayOfYear + 2) / 153;
+        dayOut                       = static_cast<int>(dayOfYear - (153 * mp + 2) / 5 + 1);
+        monthOut                     = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+        yearOut                      = static_cast<int>(yoe + era * 400 + (monthOut <= 2 ? 1 : 0));
     }
-} // namespace
 
-bool TimeMgr::ResolveTimeZoneOffset(const std::string& timeZoneName, std::time_t whenUtc, float& offsetHours, bool* pIsDst)
-{
-    std::string zone = trim_copy(timeZoneName);
-    if (zone.empty())
+    int utc_year(std::time_t whenUtc)
     {
-        offsetHours = 0.0f;
-        if (pIsDst != nullptr)
+        int64_t days = static_cast<int64_t>(whenUtc) / 86400;
+        if (static_cast<int64_t>(whenUtc) % 86400 < 0)
         {
-            *pIsDst = false;
+            --days;
         }
-        return true;
+        int year  = 0;
+        int month = 0;
+        int day   = 0;
+        civil_from_epoch_days(days, year, month, day);
+        return year;
     }
 
-    const std::string lower = to_lower_copy(zone);
-    if (lower == "utc" || lower == "gmt")
+    void put_2digits(char* pDst, unsigned int value)
     {
-        offsetHours = 0.0f;
-        if (pIsDst != nullptr)
-        {
-            *pIsDst = false;
-        }
-        return true;
+        pDst[0] = static_cast<char>('0' + value / 10);
+        pDst[1] = static_cast<char>('0' + value % 10);
     }
 
-    if (lower.rfind("utc", 0) == 0 || lower.rfind("gmt", 0) == 0)
+    void format_civil_date(TimeMgr::CivilTime& civil)
     {
-        std::string suffix = lower.substr(3);
-        if (!suffix.empty())
-        {
-            int totalMinutes = 0;
-            if (parse_numeric_offset(suffix, totalMinutes))
-            {
-                offsetHours = static_cast<float>(totalMinutes) / 60.0f;
-                if (pIsDst != nullptr)
-                {
-                    *pIsDst = false;
-                }
-                return true;
-            }
-        }
+        put_2digits(civil.szDate, static_cast<unsigned int>(civil.year) / 100);
+        put_2digits(civil.szDate + 2, static_cast<unsigned int>(civil.year) % 100);
+        civil.szDate[4] = '-';
+        put_2digits(civil.szDate + 5, civil.month);
+        civil.szDate[7] = '-';
+        put_2digits(civil.szDate + 8, civil.day);
+        civil.szDate[10] = '\0';
     }
 
-    const DstOverride dstOverride = parse_dst_override();
-    const bool isDst              = (whenUtc > 0) ? resolve_dst_for_rule(dstOverride, whenUtc, DstRule::NorthernHemisphere) : false;
-
-    if (lower == "america/new_york" || lower == "america/toronto" || lower == "america/halifax")
+    void format_civil_time(TimeMgr::CivilTime& civil)
     {
-        offsetHours = isDst ? -4.0f : -5.0f;
-        if (pIsDst != nullptr)
-        {
-            *pIsDst = isDst;
-        }
-        return true;
+        put_2digits(civil.szTime, civil.hour);
+        civil.szTime[2] = ':';
+        put_2digits(civil.szTime + 3, civil.minute);
+        civil.szTime[5] = ':';
+        put_2digits(civil.szTime + 6, civil.second);
+        civil.szTime[8] = '\0';
     }
-    if (lower == "america/chicago" || lower == "america/mexico_city")
+
+    void compute_civil(TimeMgr::CivilTime& civil, std::time_t epoch, int32_t offsetSec)
     {
-        offsetHours = isDst ? -5.0f : -6.0f;
-        if (pIsDst != nullptr)
+        const int64_t local = static_cast<int64_t>(epoch) + offsetSec;
+        int64_t days        = local / 86400;
+        int64_t secOfDay    = local % 86400;
+        if (secOfDay < 0)
         {
-            *pIsDst = isDst;
+            secOfDay += 86400;
+            --days;
         }
-        return true;
+
+        int year  = 0;
+        int month = 0;
+        int day   = 0;
+        civil_from_epoch_days(days, year, month, day);
+        civil.epoch     = epoch;
+        civil.offsetSec = offsetSec;
+        civil.year      = static_cast<int16_t>(year);
+        civil.month     = static_cast<uint8_t>(month);
+        civil.day       = static_cast<uint8_t>(day);
+        civil.hour      = static_cast<uint8_t>(secOfDay / 3600);
+        civil.minute    = static_cast<uint8_t>((secOfDay / 60) % 60);
+        civil.second    = static_cast<uint8_t>(secOfDay % 60);
+        civil.weekday   = static_cast<uint8_t>(((days % 7) + 11) % 7); // 1970-01-01 was a Thursday
+        format_civil_date(civil);
+        format_civil_time(civil);
     }
-    if (lower == "america/denver")
+
+    // One second forward, carrying into minutes, hours and days and touching only the digits that change
+    void advance_civil(TimeMgr::CivilTime& civil)
     {
-        offsetHours = isDst ? -6.0f : -7.0f;
-        if (pIsDst != nullptr)
+        civil.epoch += 1;
+        if (++civil.second < 60)
         {
-            *pIsDst = isDst;
+            put_2digits(civil.szTime + 6, civil.second);
+            return;
         }
-        return true;
-    }
-    if (lower == "america/los_angeles" || lower == "america/vancouver")
-    {
-        offsetHours = isDst ? -7.0f : -8.0f;
-        if (pIsDst != nullptr)
+        civil.second = 0;
+        if (++civil.minute < 60)
         {
-            *pIsDst = isDst;
+            format_civil_time(civil);
+            return;
         }
-        return true;
-    }
-    if (lower == "america/phoenix")
-    {
-        offsetHours = -7.0f;
-        if (pIsDst != nullptr)
+        civil.minute = 0;
+        if (++civil.hour < 24)
         {
-            *pIsDst = false;
+            format_civil_time(civil);
+            return;
         }
-        return true;
-    }
-    if (lower == "europe/london" || lower == "europe/ireland" || lower == "europe/dublin")
-    {
-        const bool dst = (whenUtc > 0) ? resolve_dst_for_rule(dstOverride, whenUtc, DstRule::European) : false;
-        offsetHours    = dst ? 1.0f : 0.0f;
-        if (pIsDst != nullptr)
+        civil.hour    = 0;
+        civil.weekday = static_cast<uint8_t>((civil.weekday + 1) % 7);
+        format_civil_time(civil);
+
+        static const uint8_t monthLengths[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        const uint8_t monthLength = monthLengths[civil.month - 1] + ((civil.month == 2 && is_leap_year(civil.year)) ? 1 : 0);
+        if (++civil.day > monthLength)
         {
-            *pIsDst = dst;
+            civil.day = 1;
+            if (++civil.month > 12)
+            {
+                civil.month = 1;
+                civil.year += 1;
+            }
         }
-        return true;
+        format_civil_date(civil);
     }
-    if (lower == "europe/paris" || lower == "europe/berlin" || lower == "europe/amsterdam" || lower == "europe/rome" ||
-        lower == "europe/madrid")
+
+    void update_civil(TimeMgr::CivilTime& civil, std::time_t epoch, int32_t offsetSec)
     {
-        const bool dst = (whenUtc > 0) ? resolve_dst_for_rule(dstOverride, whenUtc, DstRule::European) : false;
-        offsetHours    = dst ? 2.0f : 1.0f;
-        if (pIsDst != nullptr)
+        if (civil.epoch != 0 && civil.offsetSec == offsetSec)
         {
-            *pIsDst = dst;
-        }
-        return true;
+            if (epoch == civil.epoch)
+            {
+                return;
+            }
+            if (epoch == civil.epoch + 1)
+            {
+                advance_civil(civil);
+                return;
+            }
+        }
+        compute_civil(civil, epoch, offsetSec);
     }
-    if (lower == "asia/tokyo" || lower == "asia/seoul" || lower == "asia/shanghai" || lower == "asia/hong_kong")
+
+    // POSIX TZ parsing: std offset [dst [offset] [,start[/time],end[/time]]]
+    bool parse_tz_name(const char*& p)
     {
-        offsetHours = 9.0f;
-        if (pIsDst != nullptr)
+        if (*p == '<')
         {
-            *pIsDst = false;
+            const char* end = std::strchr(p, '>');
+            if (end == nullptr || end - p < 4)
+            {
+                return false;
+            }
+            p = end + 1;
+            return true;
         }
+        const char* start = p;
+        while (std::isalpha(static_cast<unsigned char>(*p)))
+        {
+            ++p;
+        }
+        return p - start >= 3;
+    }
+
+    bool parse_tz_number(const char*& p, int maxValue, int& valueOut)
+    {
+        if (!std::isdigit(static_cast<unsigned char>(*p)))
+        {
+            return false;
+        }
+        int value = 0;
+        while (std::isdigit(static_cast<unsigned char>(*p)))
+        {
+            value = value * 10 + (*p++ - '0');
+            if (value > maxValue)
+            {
+                return false;
+            }
+        }
+        valueOut = value;
         return true;
     }
-    if (lower == "asia/kolkata")
+
+    // [+-]hh[:mm[:ss]] in seconds, sign as written
+    bool parse_tz_time(const char*& p, int maxHours, int32_t& secondsOut)
     {
-        offsetHours = 5.5f;
-        if (pIsDst != nullptr)
+        int sign = 1;
+        if (*p == '+' || *p == '-')
         {
-            *pIsDst = false;
+            sign = (*p == '-') ? -1 : 1;
+            ++p;
         }
+        int hours   = 0;
+        int minutes = 0;
+        int seconds = 0;
+        if (!parse_tz_number(p, maxHours, hours))
+        {
+            return false;
+        }
+        if (*p == ':')
+        {
+            ++p;
+            if (!parse_tz_number(p, 59, minutes))
+            {
+                return false;
+            }
+            if (*p == ':')
+            {
+                ++p;
+                if (!parse_tz_number(p, 59, seconds))
+                {
+                    return false;
+                }
+            }
+        }
+        secondsOut = sign * (hours * 3600 + minutes * 60 + seconds);
         return true;
     }
-    if (lower == "australia/sydney" || lower == "australia/melbourne")
+
+    bool parse_tz_rule(const char*& p, TimeMgr::TransitionRule& rule)
     {
-        const bool dst = (whenUtc > 0) ? resolve_dst_for_rule(dstOverride, whenUtc, DstRule::SouthernHemisphere) : false;
-        offsetHours    = dst ? 11.0f : 10.0f;
-        if (pIsDst != nullptr)
+        int value = 0;
+        rule      = TimeMgr::TransitionRule{};
+        if (*p == 'M')
+        {
+            int month   = 0;
+            int week    = 0;
+            int weekday = 0;
+            ++p;
+            if (!parse_tz_number(p, 12, month) || month < 1 || *p++ != '.' || !parse_tz_number(p, 5, week) || week < 1 || *p++ != '.' ||
+                !parse_tz_number(p, 6, weekday))
+            {
+                return false;
+            }
+            rule.type    = TimeMgr::TransitionRule::MonthWeekDay;
+            rule.month   = static_cast<uint8_t>(month);
+            rule.week    = static_cast<uint8_t>(week);
+            rule.weekday = static_cast<uint8_t>(weekday);
+        }
+        else if (*p == 'J')
         {
-            *pIsDst = dst;
+            ++p;
+            if (!parse_tz_number(p, 365, value) || value < 1)
+            {
+                return false;
+            }
+            rule.type = TimeMgr::TransitionRule::JulianNoLeap;
+            rule.day  = static_cast<uint16_t>(value);
+        }
+        else
+        {
+            if (!parse_tz_number(p, 365, value))
+            {
+                return false;
+            }
+            rule.type = TimeMgr::TransitionRule::JulianZero;
+            rule.day  = static_cast<uint16_t>(value);
+        }
+
+        rule.timeSec = 2 * 3600; // default 02:00:00
+        if (*p == '/')
+        {
+            ++p;
+            return parse_tz_time(p, 167, rule.timeSec);
         }
         return true;
     }
 
-    int totalMinutes = 0;
-    if (parse_numeric_offset(zone, totalMinutes))
+    bool parse_posix_tz(const char* p, TimeMgr::TimeZone& zone)
+    {
+        int32_t offset = 0;
+        if (!parse_tz_name(p) || !parse_tz_time(p, 24, offset))
+        {
+            return false;
+        }
+        zone              = TimeMgr::TimeZone{};
+        zone.stdOffsetSec = -offset; // POSIX offsets are west of UTC
+        zone.dstOffsetSec = zone.stdOffsetSec;
+        if (*p == '\0')
+        {
+            return true;
+        }
+
+        if (!parse_tz_name(p))
+        {
+            return false;
+        }
+        zone.bHasDst      = true;
+        zone.dstOffsetSec = zone.stdOffsetSec + 3600;
+        if (*p != ',' && *p != '\0')
+        {
+            if (!parse_tz_time(p, 24, offset))
+            {
+                return false;
+            }
+            zone.dstOffsetSec = -offset;
+        }
+
+        if (*p == '\0')
+        {
+            // No rules given, use the US rules as most implementations do
+            const char* defaultRules = "M3.2.0,M11.1.0";
+            return parse_tz_rule(defaultRules, zone.dstStart) && *defaultRules++ == ',' && parse_tz_rule(defaultRules, zone.dstEnd);
+        }
+        return *p++ == ',' && parse_tz_rule(p, zone.dstStart) && *p++ == ',' && parse_tz_rule(p, zone.dstEnd) && *p == '\0';
+    }
+
+    // UTC instant of a transition in the given year; localOffsetSec is the offset in effect before it
+    std::time_t transition_utc(int year, const TimeMgr::TransitionRule& rule, int32_t localOffsetSec)
+    {
+        static const int monthLengths[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        std::time_t dayStart            = 0;
+        switch (rule.type)
+        {
+        case TimeMgr::TransitionRule::JulianNoLeap:
+        {
+            // Day 60 is always March 1
+            int day = rule.day;
+            int month = 1;
+            while (day > monthLengths[month - 1])
+            {
+                day -= monthLengths[month - 1];
+                ++month;
+            }
+            dayStart = utc_time_from_ymdhms(year, month, day, 0, 0, 0);
+            break;
+        }
+        case TimeMgr::TransitionRule::JulianZero:
+            dayStart = utc_time_from_ymdhms(year, 1, 1, 0, 0, 0) + static_cast<std::time_t>(rule.day) * 86400;
+            break;
+        case TimeMgr::TransitionRule::MonthWeekDay:
+        default:
+        {
+            int day          = 1 + (7 + rule.weekday - day_of_week(year, rule.month, 1)) % 7 + (rule.week - 1) * 7;
+            int monthLength  = monthLengths[rule.month - 1] + ((rule.month == 2 && is_leap_year(year)) ? 1 : 0);
+            while (day > monthLength)
+            {
+                day -= 7; // week 5 means the last such weekday
+            }
+            dayStart = utc_time_from_ymdhms(year, rule.month, day, 0, 0, 0);
+            break;
+        }
+        }
+        return dayStart + rule.timeSec - localOffsetSec;
+    }
+
+    void dst_transitions(const TimeMgr::TimeZone& zone, int year, std::time_t& startUtc, std::time_t& endUtc)
+    {
+        startUtc = transition_utc(year, zone.dstStart, zone.stdOffsetSec);
+        endUtc   = transition_utc(year, zone.dstEnd, zone.dstOffsetSec);
+    }
+
+    bool is_dst_at(const TimeMgr::TimeZone& zone, std::time_t whenUtc, std::time_t startUtc, std::time_t endUtc)
+    {
+        static const DstOverride dstOverride = parse_dst_override();
+        if (!zone.bHasDst || dstOverride == DstOverride::Off)
+        {
+            return false;
+        }
+        if (dstOverride == DstOverride::On)
+        {
+            return true;
+        }
+        // Southern hemisphere rules start DST late in the year and end it early in the next
+        return (startUtc < endUtc) ? (whenUtc >= startUtc && whenUtc < endUtc) : (whenUtc >= startUtc || whenUtc < endUtc);
+    }
+
+#if TIMEMGR_ENABLE_NTP
+    enum class NtpState : uint8_t
+    {
+        Idle,
+        Resolving,
+        Resolved,
+        Waiting,
+        Done,
+        Failed,
+    };
+
+    struct NtpQuery
+    {
+        volatile NtpState state;
+        ip_addr_t serverAddr;
+        struct udp_pcb* pUdp;
+        int64_t originUs;           // T1, our transmit time
+        volatile int64_t receiveUs; // T4, our receive time
+        std::array<uint8_t, ntpPacketSize> response;
+    };
+
+    int64_t epoch_now_us()
     {
-        offsetHours = static_cast<float>(totalMinutes) / 60.0f;
-        if (pIsDst != nullptr)
+        timeval tv{};
+        gettimeofday(&tv, nullptr);
+        return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
+    uint64_t read_be64(const uint8_t* pData)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++)
         {
-            *pIsDst = false;
+            value = (value << 8) | pData[i];
         }
+        return value;
+    }
+
+    // NTP 32.32 fixed point seconds since 1900 to Unix microseconds, and back
+    int64_t ntp_to_unix_us(uint64_t ntpTime)
+    {
+        const int64_t seconds = static_cast<int64_t>(ntpTime >> 32) - static_cast<int64_t>(ntpEpochDeltaSeconds);
+        return seconds * 1000000 + static_cast<int64_t>(((ntpTime & 0xffffffffULL) * 1000000) >> 32);
+    }
+
+    uint64_t unix_us_to_ntp(int64_t unixUs)
+    {
+        const uint64_t seconds  = static_cast<uint64_t>(unixUs / 1000000) + ntpEpochDeltaSeconds;
+        const uint64_t fraction = (static_cast<uint64_t>(unixUs % 1000000) << 32) / 1000000;
+        return (seconds << 32) | fraction;
+    }
+
+    void ntp_recv_callback(void* arg, struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* addr, u16_t port)
+    {
+        (void)pcb;
+        const int64_t receiveUs = epoch_now_us();
+        auto* pQuery            = static_cast<NtpQuery*>(arg);
+        if (pQuery == nullptr || p == nullptr)
+        {
+            if (p != nullptr)
+            {
+                pbuf_free(p);
+            }
+            return;
+        }
+
+        // Ignore strays and late duplicates rather than failing the query
+        if (pQuery->state != NtpState::Waiting || port != ntpPort || !ip_addr_cmp(addr, &pQuery->serverAddr) || p->tot_len < ntpPacketSize ||
+            pbuf_copy_partial(p, pQuery->response.data(), ntpPacketSize, 0) != ntpPacketSize)
+        {
+            pbuf_free(p);
+            return;
+        }
+        pbuf_free(p);
+
+        pQuery->receiveUs = receiveUs;
+        pQuery->state     = NtpState::Done;
+    }
+
+    void ntp_dns_found_callback(const char* name, const ip_addr_t* ipaddr, void* arg)
+    {
+        (void)name;
+        auto* pQuery = static_cast<NtpQuery*>(arg);
+        if (pQuery == nullptr || pQuery->state != NtpState::Resolving)
+        {
+            return;
+        }
+
+        if (ipaddr == nullptr)
+        {
+            pQuery->state = NtpState::Failed;
+            return;
+        }
+
+        pQuery->serverAddr = *ipaddr;
+        pQuery->state      = NtpState::Resolved;
+    }
+
+    void send_ntp_request(NtpQuery& query)
+    {
+        std::array<uint8_t, ntpPacketSize> request{};
+        request[0] = 0x23; // LI 0, version 4, mode 3 (client)
+
+        cyw43_arch_lwip_begin();
+        query.pUdp = udp_new_ip_type(IP_GET_TYPE(&query.serverAddr));
+        struct pbuf* pPacket = (query.pUdp != nullptr) ? pbuf_alloc(PBUF_TRANSPORT, request.size(), PBUF_RAM) : nullptr;
+        err_t sendErr        = ERR_MEM;
+        if (pPacket != nullptr)
+        {
+            udp_recv(query.pUdp, ntp_recv_callback, &query);
+            query.state    = NtpState::Waiting;
+            query.originUs = epoch_now_us();
+
+            // The server echoes our transmit time as its originate time, which ties the reply to this request
+            const uint64_t origin = unix_us_to_ntp(query.originUs);
+            for (int i = 0; i < 8; i++)
+            {
+                request[40 + i] = static_cast<uint8_t>(origin >> (56 - 8 * i));
+            }
+            std::memcpy(pPacket->payload, request.data(), request.size());
+            sendErr = udp_sendto(query.pUdp, pPacket, &query.serverAddr, ntpPort);
+            pbuf_free(pPacket);
+        }
+        cyw43_arch_lwip_end();
+
+        if (sendErr != ERR_OK)
+        {
+            query.state = NtpState::Failed;
+        }
+    }
+
+    // Offset and round-trip delay from the four timestamps; false if the reply is unusable
+    bool ntp_sample(const NtpQuery& query, int64_t& offsetUs, int64_t& delayUs)
+    {
+        const uint8_t* pPacket = query.response.data();
+        const uint8_t leap     = pPacket[0] >> 6;
+        const uint8_t mode     = pPacket[0] & 0x07;
+        const uint8_t stratum  = pPacket[1];
+        if (leap == 3 || mode != 4 || stratum == 0 || stratum > 15 || read_be64(pPacket + 24) != unix_us_to_ntp(query.originUs))
+        {
+            return false;
+        }
+
+        const int64_t t1 = query.originUs;
+        const int64_t t2 = ntp_to_unix_us(read_be64(pPacket + 32));
+        const int64_t t3 = ntp_to_unix_us(read_be64(pPacket + 40));
+        const int64_t t4 = query.receiveUs;
+        offsetUs         = ((t2 - t1) + (t3 - t4)) / 2;
+        delayUs          = (t4 - t1) - (t3 - t2);
+        return delayUs >= 0;
+    }
+#endif
+
+    size_t format_uptime_timestamp(char* pBuf, size_t nSize)
+    {
+        const uint64_t nowUs    = time_us_64();
+        const uint64_t totalMs  = nowUs / 1000;
+        const uint64_t ms       = totalMs % 1000;
+        const uint64_t totalSec = totalMs / 1000;
+        const uint64_t sec      = totalSec % 60;
+        const uint64_t min      = (totalSec / 60) % 60;
+        const uint64_t hour     = totalSec / 3600;
+
+        const int n = std::snprintf(pBuf, nSize, "UP %02u:%02u:%02u.%03u", static_cast<unsigned int>(hour), static_cast<unsigned int>(min),
+                                    static_cast<unsigned int>(sec), static_cast<unsigned int>(ms));
+        return (n < 0) ? 0 : std::min(static_cast<size_t>(n), nSize - 1);
+    }
+
+    constexpr size_t logLineSize = 256;
+    constexpr const char* logLevelTags[] = {"", "ERROR: ", "WARN: ", "", "DEBUG: "};
+} // namespace
+
+uint32_t TimeMgr::sm_nPpsPin                                 = 0;
+volatile uint64_t TimeMgr::sm_nPpsEdgeUs[PPS_EDGE_HISTORY] = {};
+volatile uint32_t TimeMgr::sm_nPpsEdgeCount                = 0;
+TimeMgr::CivilTime TimeMgr::sm_utcNow                      = {};
+
+bool TimeMgr::ParseTimeZone(const std::string& timeZoneName, TimeZone& zone)
+{
+    zone             = TimeZone{};
+    std::string name = trim_copy(timeZoneName);
+    if (name.empty())
+    {
+        return true;
+    }
+
+    const std::string lower = to_lower_copy(name);
+    if (lower == "utc" || lower == "gmt")
+    {
         return true;
     }
 
-    offsetHours = 0.0f;
+    // UTC+hh[:mm] / GMT-hh[:mm] and bare offsets are east of UTC, unlike POSIX
+    int totalMinutes = 0;
+    if (((lower.rfind("utc", 0) == 0 || lower.rfind("gmt", 0) == 0) && parse_numeric_offset(lower.substr(3), totalMinutes)) ||
+        parse_numeric_offset(name, totalMinutes))
+    {
+        zone.stdOffsetSec = totalMinutes * 60;
+        zone.dstOffsetSec = zone.stdOffsetSec;
+        return true;
+    }
+
+    const TimeZoneRule* pRule = find_time_zone(name.c_str(), name.size());
+    if (pRule != nullptr)
+    {
+        return parse_posix_tz(pRule->posix, zone);
+    }
+
+    return parse_posix_tz(name.c_str(), zone);
+}
+
+bool TimeMgr::ResolveTimeZoneOffset(const std::string& timeZoneName, std::time_t whenUtc, float& offsetHours, bool* pIsDst)
+{
+    TimeZone zone;
+    const bool bParsed = ParseTimeZone(timeZoneName, zone);
+
+    bool isDst = false;
+    if (bParsed && zone.bHasDst && whenUtc > 0)
+    {
+        std::time_t startUtc = 0;
+        std::time_t endUtc   = 0;
+        dst_transitions(zone, utc_year(whenUtc), startUtc, endUtc);
+        isDst = is_dst_at(zone, whenUtc, startUtc, endUtc);
+    }
+
+    offsetHours = bParsed ? static_cast<float>(isDst ? zone.dstOffsetSec : zone.stdOffsetSec) / 3600.0f : 0.0f;
     if (pIsDst != nullptr)
     {
-        *pIsDst = false;
+        *pIsDst = isDst;
     }
-    return false;
+    return bParsed;
 }
 
 bool TimeMgr::IsWallClockValid()
 {
-    return static_cast<uint64_t>(std::time(nullptr)) >= validEpochThresholdSec;
+    return std::time(nullptr) >= buildEpochSec;
 }
 
 uint64_t TimeMgr::CurrentEpochSeconds()
@@ -650,20 +1136,22 @@ uint64_t TimeMgr::CurrentEpochSeconds()
     return static_cast<uint64_t>(std::time(nullptr));
 }
 
-std::string TimeMgr::FormatCurrentTimestamp()
+size_t TimeMgr::FormatCurrentTimestamp(char* pBuf, size_t nSize)
 {
     if (!IsWallClockValid())
     {
-        return format_uptime_timestamp();
+        return format_uptime_timestamp(pBuf, nSize);
     }
 
-    const std::time_t now = std::time(nullptr);
-    std::tm tmNow{};
-    localtime_r(&now, &tmNow);
+    const CivilTime& now = UtcNow();
+    const int n          = std::snprintf(pBuf, nSize, "%s %s", now.szDate, now.szTime);
+    return (n < 0) ? 0 : std::min(static_cast<size_t>(n), nSize - 1);
+}
 
-    char buf[32] = {0};
-    std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tmNow);
-    return std::string(buf);
+std::string TimeMgr::FormatCurrentTimestamp()
+{
+    char buf[32];
+    return std::string(buf, FormatCurrentTimestamp(buf, sizeof(buf)));
 }
 
 std::string TimeMgr::FormatCurrentTimeHMS()
@@ -672,124 +1160,250 @@ std::string TimeMgr::FormatCurrentTimeHMS()
     {
         return "";
     }
+    return std::string(UtcNow().szTime);
+}
 
-    const std::time_t now = std::time(nullptr);
-    std::tm tmNow{};
-    localtime_r(&now, &tmNow);
+const TimeMgr::CivilTime& TimeMgr::UtcNow()
+{
+    update_civil(sm_utcNow, std::time(nullptr), 0);
+    return sm_utcNow;
+}
 
-    char buf[32] = {0};
-    std::strftime(buf, sizeof(buf), "%H:%M:%S", &tmNow);
-    return std::string(buf);
+const TimeMgr::CivilTime& TimeMgr::LocalNow()
+{
+    const int32_t offsetSec = m_hasTimeZoneOffset ? (m_isDst ? m_zone.dstOffsetSec : m_zone.stdOffsetSec) : 0;
+    update_civil(m_localNow, std::time(nullptr), offsetSec);
+    return m_localNow;
 }
 
-void TimeMgr::LogInfo(const std::string& message)
+void TimeMgr::Log(int level, const char* fmt, ...)
 {
-    std::cout << '[' << FormatCurrentTimestamp() << "] " << message << std::endl;
+    va_list args;
+    va_start(args, fmt);
+    LogV(level, fmt, args);
+    va_end(args);
+}
+
+void TimeMgr::LogV(int level, const char* fmt, va_list args)
+{
+    char line[logLineSize];
+    size_t nLen = 0;
+    line[nLen++] = '[';
+    nLen += FormatCurrentTimestamp(line + nLen, sizeof(line) - nLen);
+    nLen += std::snprintf(line + nLen, sizeof(line) - nLen, "] %s", logLevelTags[level < LOG_LEVEL_NONE || level > LOG_LEVEL_DEBUG ? 0 : level]);
+
+    // Leave room for the newline; vsnprintf reports the untruncated length
+    const int nMsg = std::vsnprintf(line + nLen, sizeof(line) - nLen - 1, fmt, args);
+    if (nMsg > 0)
+    {
+        nLen = std::min(nLen + static_cast<size_t>(nMsg), sizeof(line) - 2);
+    }
+    while (nLen > 0 && line[nLen - 1] == '\n')
+    {
+        --nLen;
+    }
+    line[nLen++] = '\n';
+#if defined(LOG_ASYNC)
+    LogRing::Put(line, nLen);
+#else
+    std::fwrite(line, 1, nLen, stdout);
+#endif
 }
 
 TimeMgr::TimeMgr(std::string timeZoneName)
     : m_timeZoneName(std::move(timeZoneName)),
       m_timeZoneOffsetHours(0.0f),
       m_isDst(false),
-      m_hasTimeZoneOffset(false)
+      m_hasTimeZoneOffset(false),
+      m_zone{},
+      m_bZoneResolved(false),
+      m_bZoneValid(false),
+      m_yearStartUtc(0),
+      m_yearEndUtc(0),
+      m_dstStartUtc(0),
+      m_dstEndUtc(0),
+      m_bPpsEnabled(false),
+      m_bPpsSynced(false),
+      m_nLastEdgeUs(0),
+      m_nAnchorLocalUs(0),
+      m_anchorUtc(0),
+      m_dDriftPpm(0.0),
+      m_bDriftValid(false),
+      m_dDriftErrorPpm(uncalibratedDriftPpm),
+      m_timeSource(TimeSource::None),
+      m_nSyncLocalUs(0),
+      m_nSyncEpochUs(0),
+      m_nSyncErrorUs(0),
+      m_nLastGpsTimeUs(0),
+      m_nLastHoldoverUs(0),
+      m_bHoldover(false),
+      m_localNow{},
+      m_nLeapSeconds(defaultGpsUtcLeapSec),
+      m_bLeapKnown(false),
+      m_bRolloverLogged(false)
 {
 }
 
-bool TimeMgr::SetTimeFromNtp(uint32_t timeoutMs)
+#if TIMEMGR_ENABLE_NTP
+struct TimeMgr::NtpSession
+{
+    std::array<NtpQuery, ntpServerCount> queries;
+    bool bActive;
+    uint64_t nRoundStartUs;
+    uint64_t nNextRoundUs;
+};
+#else
+struct TimeMgr::NtpSession
 {
-    (void)timeoutMs;
+};
+#endif
 
-    if (IsWallClockValid())
-    {
-        return true;
-    }
+TimeMgr::~TimeMgr() = default;
 
+bool TimeMgr::PollNtp()
+{
 #if !TIMEMGR_ENABLE_NTP
     return false;
 #else
-    NtpQueryContext ctx{};
-
-    cyw43_arch_lwip_begin();
-    err_t dnsErr = dns_gethostbyname("pool.ntp.org", &ctx.serverAddr, ntp_dns_found_callback, &ctx);
-    cyw43_arch_lwip_end();
-
-    if (dnsErr == ERR_OK)
+#if PICO_CYW43_ARCH_POLL
+    cyw43_arch_poll();
+#endif
+    if (!m_spNtp)
     {
-        ctx.bDnsReady = true;
+        m_spNtp = std::make_unique<NtpSession>();
     }
-    else if (dnsErr != ERR_INPROGRESS)
+    NtpSession& session  = *m_spNtp;
+    const uint64_t nowUs = time_us_64();
+
+    if (!session.bActive)
     {
+        // PPS is far better than anything NTP can offer over Wi-Fi
+        if (m_bPpsSynced || nowUs < session.nNextRoundUs)
+        {
+            return false;
+        }
+        startNtpRound();
         return false;
     }
 
-    if (!wait_for_flag(ctx.bDnsReady, ctx.bDnsFailed, timeoutMs / 2))
+    bool bPending = false;
+    for (NtpQuery& query : session.queries)
+    {
+        if (query.state == NtpState::Resolved)
+        {
+            send_ntp_request(query);
+        }
+        bPending = bPending || query.state == NtpState::Resolving || query.state == NtpState::Waiting;
+    }
+    if (bPending && nowUs - session.nRoundStartUs < ntpRoundTimeoutUs)
     {
         return false;
     }
 
-    cyw43_arch_lwip_begin();
-    ctx.pUdp = udp_new_ip_type(IP_GET_TYPE(ctx.serverAddr));
-    if (ctx.pUdp != nullptr)
-    {
-        udp_recv(ctx.pUdp, ntp_recv_callback, &ctx);
+    return finishNtpRound();
+#endif
+}
 
-        std::array<uint8_t, ntpPacketSize> request{};
-        request[0] = 0x1b;
+#if TIMEMGR_ENABLE_NTP
+void TimeMgr::startNtpRound()
+{
+    NtpSession& session   = *m_spNtp;
+    session.bActive       = true;
+    session.nRoundStartUs = time_us_64();
 
-        struct pbuf* pPacket = pbuf_alloc(PBUF_TRANSPORT, request.size(), PBUF_RAM);
-        if (pPacket != nullptr)
+    for (size_t i = 0; i < ntpServerCount; i++)
+    {
+        NtpQuery& query = session.queries[i];
+        if (query.state == NtpState::Resolving)
         {
-            std::memcpy(pPacket->payload, request.data(), request.size());
-            err_t sendErr = udp_sendto(ctx.pUdp, pPacket, &ctx.serverAddr, ntpPort);
-            pbuf_free(pPacket);
-            if (sendErr != ERR_OK)
-            {
-                ctx.bResponseFailed = true;
-            }
+            continue; // Still waiting on DNS from an earlier round
         }
-        else
+        query.state  = NtpState::Resolving;
+        query.pUdp   = nullptr;
+        query.originUs = 0;
+
+        cyw43_arch_lwip_begin();
+        const err_t dnsErr = dns_gethostbyname(ntpServers[i], &query.serverAddr, ntp_dns_found_callback, &query);
+        cyw43_arch_lwip_end();
+        if (dnsErr == ERR_OK)
         {
-            ctx.bResponseFailed = true;
+            query.state = NtpState::Resolved;
+        }
+        else if (dnsErr != ERR_INPROGRESS)
+        {
+            query.state = NtpState::Failed;
         }
     }
-    else
-    {
-        ctx.bResponseFailed = true;
-    }
-    cyw43_arch_lwip_end();
+}
 
-    const bool bReceived = wait_for_flag(ctx.bResponseReady, ctx.bResponseFailed, timeoutMs);
+bool TimeMgr::finishNtpRound()
+{
+    NtpSession& session = *m_spNtp;
+    session.bActive     = false;
 
-    cyw43_arch_lwip_begin();
-    if (ctx.pUdp != nullptr)
+    const NtpQuery* pBest = nullptr;
+    int64_t bestOffsetUs  = 0;
+    int64_t bestDelayUs   = 0;
+    for (size_t i = 0; i < ntpServerCount; i++)
     {
-        udp_remove(ctx.pUdp);
-        ctx.pUdp = nullptr;
+        NtpQuery& query = session.queries[i];
+        cyw43_arch_lwip_begin();
+        if (query.pUdp != nullptr)
+        {
+            udp_remove(query.pUdp);
+            query.pUdp = nullptr;
+        }
+        cyw43_arch_lwip_end();
+
+        int64_t offsetUs = 0;
+        int64_t delayUs  = 0;
+        if (query.state == NtpState::Done && ntp_sample(query, offsetUs, delayUs))
+        {
+            LogDebug("NTP %s: offset %lld us, delay %lld us", ntpServers[i], static_cast<long long>(offsetUs), static_cast<long long>(delayUs));
+            if (pBest == nullptr || delayUs < bestDelayUs)
+            {
+                pBest        = &query;
+                bestOffsetUs = offsetUs;
+                bestDelayUs  = delayUs;
+            }
+        }
+        if (query.state != NtpState::Resolving)
+        {
+            query.state = NtpState::Idle;
+        }
     }
-    cyw43_arch_lwip_end();
 
-    if (!bReceived || ctx.seconds1900 <= ntpEpochDeltaSeconds)
+    if (pBest == nullptr)
     {
+        session.nNextRoundUs = time_us_64() + ntpRetryUs;
+        LogWarn("No usable NTP reply");
         return false;
     }
+    session.nNextRoundUs = time_us_64() + ntpResyncUs;
 
-    const time_t unixSeconds = static_cast<time_t>(ctx.seconds1900 - ntpEpochDeltaSeconds);
+    const bool bWasValid = IsWallClockValid();
+    const int64_t nowUs  = epoch_now_us() + bestOffsetUs;
     timeval tv{};
-    tv.tv_sec  = unixSeconds;
-    tv.tv_usec = 0;
+    tv.tv_sec  = static_cast<std::time_t>(nowUs / 1000000);
+    tv.tv_usec = static_cast<suseconds_t>(nowUs % 1000000);
     if (settimeofday(&tv, nullptr) != 0)
     {
-        LogInfo("Failed to set time from NTP: " + std::string(std::strerror(errno)));
+        LogError("Failed to set time from NTP: %s", std::strerror(errno));
         return false;
     }
+    LogInfo("NTP offset %lld us, delay %lld us", static_cast<long long>(bestOffsetUs), static_cast<long long>(bestDelayUs));
+    markSynced(TimeSource::Ntp, time_us_64(), nowUs, static_cast<uint64_t>(bestDelayUs / 2));
 
-    aon_timer_start_with_timeofday();
-    RefreshTimeZoneOffset(unixSeconds);
+    if (!bWasValid)
+    {
+        aon_timer_start_with_timeofday();
+    }
+    RefreshTimeZoneOffset(tv.tv_sec);
     return true;
-#endif
 }
+#endif
 
-bool TimeMgr::SetTimeFromGps(const std::string& gpsTime, const std::string& gpsDate)
+bool TimeMgr::SetTimeFromGps(const std::string& gpsTime, const std::string& gpsDate, uint64_t nReceivedUs)
 {
     int hour   = 0;
     int minute = 0;
@@ -800,24 +1414,278 @@ bool TimeMgr::SetTimeFromGps(const std::string& gpsTime, const std::string& gpsD
 
     if (!parse_gprmc_time(gpsTime, hour, minute, second) || !parse_gprmc_date(gpsDate, year, month, day) || !is_valid_ymd(year, month, day))
     {
-        LogInfo("Failed to parse GPS time/date: time='" + gpsTime + "', date='" + gpsDate + "'");
+        LogWarn("Failed to parse GPS time/date: time='%s', date='%s'", gpsTime.c_str(), gpsDate.c_str());
         return false;
     }
 
-    const std::time_t gpsUtc = utc_time_from_ymdhms(year, month, day, hour, minute, second);
+    if (second == 60)
+    {
+        // POSIX time has no 23:59:60, so the clock runs on through the inserted second and the next
+        // sync steps it back by one.  The drift anchor would take that second as oscillator error.
+        LogInfo("Leap second inserted, GPS-UTC was %d s%s", m_nLeapSeconds, m_bLeapKnown ? "" : " (built-in)");
+        m_anchorUtc = 0;
+        return true;
+    }
+
+    const std::time_t reportedUtc = utc_time_from_ymdhms(year, month, day, hour, minute, second);
+    const std::time_t gpsUtc      = correct_week_rollover(reportedUtc);
+    if (gpsUtc != reportedUtc && !m_bRolloverLogged)
+    {
+        m_bRolloverLogged = true;
+        LogWarn("GPS date %04d-%02d-%02d predates this build, corrected for week number rollover", year, month, day);
+    }
+
+    // The RMC time labels the PPS edge that preceded it
+    uint64_t nEdgeUs = 0;
+    if (m_bPpsEnabled && latestPpsEdge(nReceivedUs != 0 ? nReceivedUs : time_us_64(), nEdgeUs))
+    {
+        return setTimeFromPps(gpsUtc, nEdgeUs);
+    }
+    if (m_bPpsSynced)
+    {
+        return true; // Free running from the last PPS beats whole-second RMC time
+    }
+
     timeval tv{};
     tv.tv_sec  = gpsUtc;
     tv.tv_usec = 0;
     if (settimeofday(&tv, nullptr) != 0)
     {
-        LogInfo("Failed to set time from GPS: " + std::string(std::strerror(errno)));
+        LogError("Failed to set time from GPS: %s", std::strerror(errno));
         return false;
     }
     aon_timer_start_with_timeofday();
     RefreshTimeZoneOffset(gpsUtc);
+
+    const uint64_t nLocalUs = (nReceivedUs != 0) ? nReceivedUs : time_us_64();
+    updateDrift(gpsUtc, nLocalUs, gpsDriftWindowSec);
+    markSynced(TimeSource::Gps, time_us_64(), static_cast<int64_t>(gpsUtc) * 1000000, gpsSyncErrorUs);
+    return true;
+}
+
+bool TimeMgr::EnablePps(uint32_t pin)
+{
+    sm_nPpsPin       = pin;
+    sm_nPpsEdgeCount = 0;
+    gpio_init(pin);
+    gpio_set_dir(pin, GPIO_IN);
+    gpio_add_raw_irq_handler(pin, on_pps_irq);
+    gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_RISE, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    m_bPpsEnabled = true;
+    return true;
+}
+
+void TimeMgr::on_pps_irq()
+{
+    if (gpio_get_irq_event_mask(sm_nPpsPin) & GPIO_IRQ_EDGE_RISE)
+    {
+        const uint64_t nNowUs = time_us_64();
+        gpio_acknowledge_irq(sm_nPpsPin, GPIO_IRQ_EDGE_RISE);
+        sm_nPpsEdgeUs[sm_nPpsEdgeCount % PPS_EDGE_HISTORY] = nNowUs;
+        sm_nPpsEdgeCount += 1;
+    }
+}
+
+bool TimeMgr::latestPpsEdge(uint64_t nBeforeUs, uint64_t& nEdgeUs)
+{
+    // 64-bit reads are not atomic, so copy until no edge arrived meanwhile
+    uint64_t edges[PPS_EDGE_HISTORY];
+    uint32_t nCount = 0;
+    do
+    {
+        nCount = sm_nPpsEdgeCount;
+        for (size_t i = 0; i < PPS_EDGE_HISTORY; i++)
+        {
+            edges[i] = sm_nPpsEdgeUs[i];
+        }
+    } while (nCount != sm_nPpsEdgeCount);
+
+    const uint32_t nValid = std::min<uint32_t>(nCount, PPS_EDGE_HISTORY);
+    for (uint32_t i = 1; i <= nValid; i++)
+    {
+        const uint64_t nUs = edges[(nCount - i) % PPS_EDGE_HISTORY];
+        if (nUs <= nBeforeUs)
+        {
+            nEdgeUs = nUs;
+            return nBeforeUs - nUs < ppsPairWindowUs;
+        }
+    }
+    return false;
+}
+
+bool TimeMgr::setTimeFromPps(std::time_t gpsUtc, uint64_t nEdgeUs)
+{
+    if (m_bPpsSynced && nEdgeUs == m_nLastEdgeUs)
+    {
+        return true; // Already applied
+    }
+
+    // Step the clock so the edge reads exactly gpsUtc.000000
+    const bool bWasHoldover  = m_bHoldover;
+    const uint64_t nNowUs    = time_us_64();
+    const int64_t nTargetUs  = static_cast<int64_t>(gpsUtc) * 1000000 + static_cast<int64_t>(nNowUs - nEdgeUs);
+    timeval tvNow{};
+    gettimeofday(&tvNow, nullptr);
+    const int64_t nStepUs = nTargetUs - (static_cast<int64_t>(tvNow.tv_sec) * 1000000 + tvNow.tv_usec);
+
+    timeval tv{};
+    tv.tv_sec  = static_cast<std::time_t>(nTargetUs / 1000000);
+    tv.tv_usec = static_cast<suseconds_t>(nTargetUs % 1000000);
+    if (settimeofday(&tv, nullptr) != 0)
+    {
+        LogError("Failed to set time from PPS: %s", std::strerror(errno));
+        return false;
+    }
+
+    if (!m_bPpsSynced)
+    {
+        aon_timer_start_with_timeofday();
+        LogInfo("Clock disciplined to PPS, step %lld us", static_cast<long long>(nStepUs));
+        RefreshTimeZoneOffset(gpsUtc);
+        m_anchorUtc = 0; // Restart drift measurement on the precise source
+    }
+    else if (bWasHoldover)
+    {
+        // The step is the error accumulated while holding over
+        LogInfo("PPS restored after %llu s, step %lld us, estimated error was %llu us",
+                static_cast<unsigned long long>((nEdgeUs - m_nSyncLocalUs) / 1000000), static_cast<long long>(nStepUs),
+                static_cast<unsigned long long>(estimatedErrorUs()));
+    }
+    else
+    {
+        LogDebug("PPS step %lld us", static_cast<long long>(nStepUs));
+    }
+
+    updateDrift(gpsUtc, nEdgeUs, ppsDriftWindowSec);
+    markSynced(TimeSource::Pps, nEdgeUs, static_cast<int64_t>(gpsUtc) * 1000000, ppsSyncErrorUs);
+    m_nLastEdgeUs = nEdgeUs;
+    m_bPpsSynced  = true;
     return true;
 }
 
+void TimeMgr::updateDrift(std::time_t gpsUtc, uint64_t nLocalUs, int64_t nWindowSec)
+{
+    if (m_anchorUtc == 0)
+    {
+        m_anchorUtc      = gpsUtc;
+        m_nAnchorLocalUs = nLocalUs;
+        return;
+    }
+
+    const int64_t nSeconds = static_cast<int64_t>(gpsUtc - m_anchorUtc);
+    if (nSeconds < nWindowSec)
+    {
+        return;
+    }
+
+    // Local microseconds per true second, less one million, is the oscillator error in ppm
+    const int64_t nElapsedUs = static_cast<int64_t>(nLocalUs - m_nAnchorLocalUs);
+    const double dPpm        = static_cast<double>(nElapsedUs - nSeconds * 1000000) / static_cast<double>(nSeconds);
+    m_anchorUtc              = gpsUtc;
+    m_nAnchorLocalUs         = nLocalUs;
+    if (dPpm > maxDriftPpm || dPpm < -maxDriftPpm)
+    {
+        LogWarn("Discarding implausible drift of %.1f ppm", dPpm);
+        return;
+    }
+
+    // The spread of successive measurements around the estimate bounds its error
+    if (m_bDriftValid)
+    {
+        const double dResidual = (dPpm > m_dDriftPpm) ? dPpm - m_dDriftPpm : m_dDriftPpm - dPpm;
+        m_dDriftErrorPpm       = std::max(minDriftErrorPpm, m_dDriftErrorPpm + (dResidual - m_dDriftErrorPpm) / 4.0);
+        m_dDriftPpm            = m_dDriftPpm + (dPpm - m_dDriftPpm) / 4.0;
+    }
+    else
+    {
+        m_dDriftErrorPpm = uncalibratedDriftPpm / 10.0;
+        m_dDriftPpm      = dPpm;
+    }
+    m_bDriftValid = true;
+    LogInfo("Oscillator drift %.2f +/- %.2f ppm (last %lld s: %.2f ppm)", m_dDriftPpm, m_dDriftErrorPpm, static_cast<long long>(nSeconds),
+            dPpm);
+}
+
+void TimeMgr::SetLeapSeconds(int nLeapSeconds)
+{
+    if (!m_bLeapKnown || nLeapSeconds != m_nLeapSeconds)
+    {
+        LogInfo("GPS-UTC leap seconds: %d", nLeapSeconds);
+    }
+    m_nLeapSeconds = nLeapSeconds;
+    m_bLeapKnown   = true;
+}
+
+void TimeMgr::markSynced(TimeSource source, uint64_t nLocalUs, int64_t nEpochUs, uint64_t nErrorUs)
+{
+    m_timeSource      = source;
+    m_nSyncLocalUs    = nLocalUs;
+    m_nSyncEpochUs    = nEpochUs;
+    m_nSyncErrorUs    = nErrorUs;
+    m_nLastHoldoverUs = 0;
+    m_bHoldover       = false;
+}
+
+void TimeMgr::NoteGpsTime(uint64_t nReceivedUs)
+{
+    m_nLastGpsTimeUs = nReceivedUs;
+}
+
+void TimeMgr::ServiceHoldover()
+{
+    // NTP keeps to its own schedule; holdover covers losing the GPS
+    if ((m_timeSource != TimeSource::Gps && m_timeSource != TimeSource::Pps) || !m_bDriftValid)
+    {
+        return;
+    }
+
+    const uint64_t nNowUs = time_us_64();
+    if (!m_bHoldover)
+    {
+        // Disciplined to PPS, losing the edges is enough even while RMC still arrives
+        uint64_t nEdgeUs  = 0;
+        const bool bNoGps = nNowUs - m_nLastGpsTimeUs >= holdoverAfterUs;
+        const bool bNoPps = m_timeSource == TimeSource::Pps && !latestPpsEdge(nNowUs, nEdgeUs) && nNowUs - nEdgeUs >= holdoverAfterUs;
+        if (!bNoGps && !bNoPps)
+        {
+            return;
+        }
+        m_bHoldover = true;
+        LogInfo("No %s for %llu ms, holding over at %.2f ppm", bNoGps ? "GPS time" : "PPS",
+                static_cast<unsigned long long>((nNowUs - (bNoGps ? m_nLastGpsTimeUs : nEdgeUs)) / 1000), m_dDriftPpm);
+    }
+    else if (nNowUs - m_nLastHoldoverUs < holdoverIntervalUs)
+    {
+        return;
+    }
+    m_nLastHoldoverUs = nNowUs;
+
+    // Local time runs fast by the drift, so scale the elapsed local microseconds back to true ones
+    const uint64_t nElapsedUs   = nNowUs - m_nSyncLocalUs;
+    const int64_t nCorrectionUs = static_cast<int64_t>(static_cast<double>(nElapsedUs) * m_dDriftPpm / 1e6);
+    const int64_t nTargetUs     = m_nSyncEpochUs + static_cast<int64_t>(nElapsedUs) - nCorrectionUs;
+    timeval tv{};
+    tv.tv_sec  = static_cast<std::time_t>(nTargetUs / 1000000);
+    tv.tv_usec = static_cast<suseconds_t>(nTargetUs % 1000000);
+    if (settimeofday(&tv, nullptr) != 0)
+    {
+        LogError("Failed to set time in holdover: %s", std::strerror(errno));
+    }
+}
+
+uint64_t TimeMgr::estimatedErrorUs() const
+{
+    if (m_timeSource == TimeSource::None)
+    {
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    const uint64_t nElapsedUs = time_us_64() - m_nSyncLocalUs;
+    const double dDriftError  = m_bDriftValid ? m_dDriftErrorPpm : uncalibratedDriftPpm;
+    return m_nSyncErrorUs + static_cast<uint64_t>(static_cast<double>(nElapsedUs) * dDriftError / 1e6);
+}
+
 bool TimeMgr::RefreshTimeZoneOffset(std::time_t whenUtc)
 {
     const std::time_t timeToUse = (whenUtc != 0) ? whenUtc : static_cast<std::time_t>(CurrentEpochSeconds());
@@ -827,22 +1695,58 @@ bool TimeMgr::RefreshTimeZoneOffset(std::time_t whenUtc)
         return false;
     }
 
-    float offsetHours = 0.0f;
-    bool isDst        = false;
-    LogInfo("Resolving time zone offset for '" + m_timeZoneName + "' at UTC time " + std::to_string(timeToUse));
-    if (!ResolveTimeZoneOffset(m_timeZoneName, timeToUse, offsetHours, &isDst))
+    // Per-year transitions are computed once, after which this is a pair of compares
+    if (!updateTransitions(timeToUse))
     {
         m_hasTimeZoneOffset = false;
         return false;
     }
-    LogInfo("Resolved time zone offset: " + std::to_string(offsetHours) + " hours, DST: " + (isDst ? "yes" : "no"));
 
-    m_timeZoneOffsetHours = offsetHours;
+    const bool isDst = is_dst_at(m_zone, timeToUse, m_dstStartUtc, m_dstEndUtc);
+    if (!m_hasTimeZoneOffset || isDst != m_isDst)
+    {
+        LogInfo("Time zone offset for '%s': %d minutes, DST: %s", m_timeZoneName.c_str(),
+                static_cast<int>((isDst ? m_zone.dstOffsetSec : m_zone.stdOffsetSec) / 60), isDst ? "yes" : "no");
+    }
+    m_timeZoneOffsetHours = static_cast<float>(isDst ? m_zone.dstOffsetSec : m_zone.stdOffsetSec) / 3600.0f;
     m_isDst               = isDst;
     m_hasTimeZoneOffset   = true;
     return true;
 }
 
+bool TimeMgr::updateTransitions(std::time_t whenUtc)
+{
+    if (!m_bZoneResolved)
+    {
+        m_bZoneResolved = true;
+        m_bZoneValid    = ParseTimeZone(m_timeZoneName, m_zone);
+        m_yearEndUtc    = m_yearStartUtc; // force the transitions below
+        if (!m_bZoneValid)
+        {
+            LogWarn("Unknown time zone '%s'", m_timeZoneName.c_str());
+        }
+    }
+    if (!m_bZoneValid)
+    {
+        return false;
+    }
+
+    if (whenUtc >= m_yearStartUtc && whenUtc < m_yearEndUtc)
+    {
+        return true;
+    }
+
+    const int year = utc_year(whenUtc);
+    m_yearStartUtc = utc_time_from_ymdhms(year, 1, 1, 0, 0, 0);
+    m_yearEndUtc   = utc_time_from_ymdhms(year + 1, 1, 1, 0, 0, 0);
+    if (m_zone.bHasDst)
+    {
+        dst_transitions(m_zone, year, m_dstStartUtc, m_dstEndUtc);
+        LogInfo("DST transitions for %d: %lld - %lld UTC", year, static_cast<long long>(m_dstStartUtc), static_cast<long long>(m_dstEndUtc));
+    }
+    return true;
+}
+
 bool TimeMgr::IsValid() const
 {
     return IsWallClockValid() && m_hasTimeZoneOffset;
@@ -874,4 +1778,5 @@ void TimeMgr::SetTimeZoneName(std::string timeZoneName)
     m_timeZoneOffsetHours = 0.0f;
     m_isDst               = false;
     m_hasTimeZoneOffset   = false;
+    m_bZoneResolved       = false;
 }
\ No newline at end of file
@@ -7,27 +7,139 @@
 
 #pragma once
 
+#include <cstdarg>
+#include <cstddef>
 #include <cstdint>
 #include <ctime>
 #include <memory>
 #include <string>
 
+// Compile-time log levels; messages above LOG_LEVEL compile to nothing, arguments included
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+auto constexpr PPS_EDGE_HISTORY = 4; // PPS edges kept for pairing with a late RMC
+
 class TimeMgr
 {
 public:
     typedef std::shared_ptr<TimeMgr> Shared;
 
+    // One DST transition of a POSIX TZ rule: Jn (1-365, no Feb 29), n (0-365) or Mm.w.d
+    struct TransitionRule
+    {
+        enum Type : uint8_t
+        {
+            JulianNoLeap,
+            JulianZero,
+            MonthWeekDay,
+        };
+        Type type;
+        uint16_t day; // Jn / n
+        uint8_t month;
+        uint8_t week; // 1-5, 5 = last
+        uint8_t weekday;
+        int32_t timeSec; // local wall-clock time of the transition, may be negative or past 24h
+    };
+
+    // Time zone as a POSIX TZ rule, offsets east of UTC
+    struct TimeZone
+    {
+        int32_t stdOffsetSec;
+        int32_t dstOffsetSec;
+        bool bHasDst;
+        TransitionRule dstStart;
+        TransitionRule dstEnd;
+    };
+
+    // Where the clock was last set from
+    enum class TimeSource : uint8_t
+    {
+        None,
+        Gps,
+        Pps,
+        Ntp,
+    };
+
+    // Broken-down time with pre-formatted fields, advanced incrementally once per second
+    struct CivilTime
+    {
+        std::time_t epoch; // UTC seconds this was computed for, 0 if never
+        int32_t offsetSec; // added to epoch for the fields below
+        int16_t year;
+        uint8_t month;   // 1-12
+        uint8_t day;     // 1-31
+        uint8_t hour;    // 0-23
+        uint8_t minute;  // 0-59
+        uint8_t second;  // 0-59
+        uint8_t weekday; // 0 = Sunday
+        char szDate[11]; // YYYY-MM-DD
+        char szTime[9];  // HH:MM:SS
+    };
+
     explicit TimeMgr(std::string timeZoneName = "UTC");
+    ~TimeMgr();
 
+    static bool ParseTimeZone(const std::string& timeZoneName, TimeZone& zone);
     static bool ResolveTimeZoneOffset(const std::string& timeZoneName, std::time_t whenUtc, float& offsetHours, bool* pIsDst = nullptr);
     static bool IsWallClockValid();
     static uint64_t CurrentEpochSeconds();
     static std::string FormatCurrentTimestamp();
     static std::string FormatCurrentTimeHMS();
-    static void LogInfo(const std::string& message);
+    static const CivilTime& UtcNow();
+    const CivilTime& LocalNow();
+    static size_t FormatCurrentTimestamp(char* pBuf, size_t nSize);
+
+    // printf-style, formatted into a fixed stack buffer; over-long messages are truncated
+    static void Log(int level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+    static void LogV(int level, const char* fmt, va_list args);
+
+    bool PollNtp();
+    bool SetTimeFromGps(const std::string& gpsTime, const std::string& gpsDate, uint64_t nReceivedUs = 0);
+    bool EnablePps(uint32_t pin);
+    bool HasPps() const
+    {
+        return m_bPpsEnabled;
+    }
+    bool IsPpsSynced() const
+    {
+        return m_bPpsSynced;
+    }
+    double DriftPpm() const
+    {
+        return m_dDriftPpm;
+    }
 
-    bool SetTimeFromNtp(uint32_t timeoutMs = 10000);
-    bool SetTimeFromGps(const std::string& gpsTime, const std::string& gpsDate);
+    // Holdover: once GPS time, or the PPS edge the clock is disciplined to, has been missing for a few seconds,
+    // the clock is corrected for the learned drift until the next sync.  NoteGpsTime() reports each valid RMC time.
+    void NoteGpsTime(uint64_t nReceivedUs);
+    void ServiceHoldover();
+    bool InHoldover() const
+    {
+        return m_bHoldover;
+    }
+    TimeSource Source() const
+    {
+        return m_timeSource;
+    }
+
+    // GPS-UTC offset: the built-in value until the receiver reports it in UBX NAV-TIMEGPS
+    void SetLeapSeconds(int nLeapSeconds);
+    int LeapSeconds() const
+    {
+        return m_nLeapSeconds;
+    }
+    bool IsLeapSecondsKnown() const
+    {
+        return m_bLeapKnown;
+    }
     bool RefreshTimeZoneOffset(std::time_t whenUtc = 0);
     bool IsValid() const;
     bool HasTimeZoneOffset() const;
@@ -37,14 +149,84 @@ public:
     void SetTimeZoneName(std::string timeZoneName);
 
 private:
+    struct NtpSession;
+
+    bool updateTransitions(std::time_t whenUtc);
+    void startNtpRound();
+    bool finishNtpRound();
+    bool setTimeFromPps(std::time_t gpsUtc, uint64_t nEdgeUs);
+    void updateDrift(std::time_t gpsUtc, uint64_t nLocalUs, int64_t nWindowSec);
+    void markSynced(TimeSource source, uint64_t nLocalUs, int64_t nEpochUs, uint64_t nErrorUs);
+    uint64_t estimatedErrorUs() const;
+
+    static void on_pps_irq();
+    static bool latestPpsEdge(uint64_t nBeforeUs, uint64_t& nEdgeUs);
+    static uint32_t sm_nPpsPin;
+    static volatile uint64_t sm_nPpsEdgeUs[PPS_EDGE_HISTORY];
+    static volatile uint32_t sm_nPpsEdgeCount;
+    static CivilTime sm_utcNow;
+
     std::string m_timeZoneName;
     float m_timeZoneOffsetHours;
     bool m_isDst;
     bool m_hasTimeZoneOffset;
+
+    // Resolved zone and its UTC DST transitions for the year containing [m_yearStartUtc, m_yearEndUtc)
+    TimeZone m_zone;
+    bool m_bZoneResolved;
+    bool m_bZoneValid;
+    std::time_t m_yearStartUtc;
+    std::time_t m_yearEndUtc;
+    std::time_t m_dstStartUtc;
+    std::time_t m_dstEndUtc;
+
+    // PPS discipline: the last paired edge, and the anchor the drift is measured against
+    bool m_bPpsEnabled;
+    bool m_bPpsSynced;
+    uint64_t m_nLastEdgeUs;
+    uint64_t m_nAnchorLocalUs;
+    std::time_t m_anchorUtc;
+    double m_dDriftPpm;
+    bool m_bDriftValid;
+    double m_dDriftErrorPpm;
+
+    // Last sync: local time_us_64() and the true epoch microseconds at that instant
+    TimeSource m_timeSource;
+    uint64_t m_nSyncLocalUs;
+    int64_t m_nSyncEpochUs;
+    uint64_t m_nSyncErrorUs;
+    uint64_t m_nLastGpsTimeUs; // when the last valid RMC time was parsed
+    uint64_t m_nLastHoldoverUs;
+    bool m_bHoldover;
+
+    std::unique_ptr<NtpSession> m_spNtp; // created on the first PollNtp with NTP enabled
+    CivilTime m_localNow;
+
+    int m_nLeapSeconds;
+    bool m_bLeapKnown;
+    bool m_bRolloverLogged;
 };
 
-// Helper function to log messages with TimeMgr context
-inline void LogInfo(const std::string& message)
-{
-    TimeMgr::LogInfo(message);
-}
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LogError(...) TimeMgr::Log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LogError(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LogWarn(...) TimeMgr::Log(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LogWarn(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LogInfo(...) TimeMgr::Log(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LogInfo(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LogDebug(...) TimeMgr::Log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LogDebug(...) ((void)0)
+#endif
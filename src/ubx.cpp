@@ -0,0 +1,272 @@
+/*
+ * UBX binary protocol for u-blox receivers
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "ubx.h"
+
+namespace
+{
+    constexpr size_t headerSize = 4; // class, id, 16-bit length
+
+    uint16_t le_u16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    uint32_t le_u32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+               (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    int32_t le_i32(const uint8_t* p)
+    {
+        return static_cast<int32_t>(le_u32(p));
+    }
+} // namespace
+
+UbxFramer::UbxFramer()
+    : m_iHead(0),
+      m_iTail(0),
+      m_iWrite(0),
+      m_state(kIdle),
+      m_nHeaderBytes(0),
+      m_nLength(0),
+      m_nRemaining(0),
+      m_bSkip(false),
+      m_ckA(0),
+      m_ckB(0),
+      m_rxCkA(0),
+      m_nDropped(0),
+      m_nBadChecksums(0)
+{
+}
+
+void UbxFramer::put(uint8_t ch)
+{
+    m_buffer[m_iWrite] = ch;
+    m_iWrite           = (m_iWrite + 1) % UBX_BUFSIZE;
+}
+
+bool UbxFramer::Feed(uint8_t ch)
+{
+    switch (m_state)
+    {
+    case kIdle:
+        if (ch != UBX_SYNC1)
+        {
+            return false;
+        }
+        m_state = kSync2;
+        return true;
+    case kSync2:
+        if (ch != UBX_SYNC2)
+        {
+            m_state = kIdle;
+            return false;
+        }
+        m_state        = kHeader;
+        m_nHeaderBytes = 0;
+        m_ckA          = 0;
+        m_ckB          = 0;
+        return true;
+    default:
+        break;
+    }
+
+    if (m_state != kChecksumA && m_state != kChecksumB)
+    {
+        m_ckA += ch;
+        m_ckB += m_ckA;
+    }
+
+    switch (m_state)
+    {
+    case kHeader:
+        m_header[m_nHeaderBytes++] = ch;
+        if (m_nHeaderBytes == headerSize)
+        {
+            m_nLength = le_u16(m_header + 2);
+            if (m_nLength > UBX_BUFSIZE)
+            {
+                // Longer than anything we could hold, so most likely a corrupt length: resynchronise
+                m_nBadChecksums++;
+                m_state = kIdle;
+                break;
+            }
+            const size_t nFree = UBX_BUFSIZE - 1 - (m_iHead + UBX_BUFSIZE - m_iTail) % UBX_BUFSIZE;
+            m_bSkip            = m_nLength > UBX_MAX_PAYLOAD || headerSize + m_nLength > nFree;
+            if (!m_bSkip)
+            {
+                m_iWrite = m_iHead;
+                for (size_t i = 0; i < headerSize; i++)
+                {
+                    put(m_header[i]);
+                }
+            }
+            m_nRemaining = m_nLength;
+            m_state      = (m_nLength > 0) ? kPayload : kChecksumA;
+        }
+        break;
+    case kPayload:
+        if (!m_bSkip)
+        {
+            put(ch);
+        }
+        if (--m_nRemaining == 0)
+        {
+            m_state = kChecksumA;
+        }
+        break;
+    case kChecksumA:
+        m_rxCkA = ch;
+        m_state = kChecksumB;
+        break;
+    case kChecksumB:
+        if (m_rxCkA != m_ckA || ch != m_ckB)
+        {
+            m_nBadChecksums++;
+        }
+        else if (m_bSkip)
+        {
+            m_nDropped++;
+        }
+        else
+        {
+            m_iHead = m_iWrite; // publish
+        }
+        m_state = kIdle;
+        break;
+    default:
+        m_state = kIdle;
+        break;
+    }
+    return true;
+}
+
+bool UbxFramer::Pop(uint16_t& nMessage, uint8_t* pPayload, uint16_t& nLength)
+{
+    if (m_iTail == m_iHead)
+    {
+        return false;
+    }
+
+    uint8_t header[headerSize];
+    size_t iRead = m_iTail;
+    for (size_t i = 0; i < headerSize; i++)
+    {
+        header[i] = m_buffer[iRead];
+        iRead     = (iRead + 1) % UBX_BUFSIZE;
+    }
+    nMessage = static_cast<uint16_t>((header[0] << 8) | header[1]);
+    nLength  = le_u16(header + 2);
+
+    const size_t nFirst = std::min(static_cast<size_t>(nLength), UBX_BUFSIZE - iRead);
+    std::memcpy(pPayload, m_buffer + iRead, nFirst);
+    std::memcpy(pPayload + nFirst, m_buffer, nLength - nFirst);
+    m_iTail = (iRead + nLength) % UBX_BUFSIZE;
+    return true;
+}
+
+void UbxFramer::Reset()
+{
+    m_iTail = m_iHead;
+    m_state = kIdle;
+}
+
+size_t Ubx::Encode(uint16_t nMessage, const uint8_t* pPayload, uint16_t nLength, uint8_t* pOut, size_t nOutSize)
+{
+    const size_t nFrame = 2 + headerSize + nLength + 2;
+    if (nFrame > nOutSize)
+    {
+        return 0;
+    }
+    pOut[0] = UBX_SYNC1;
+    pOut[1] = UBX_SYNC2;
+    pOut[2] = static_cast<uint8_t>(nMessage >> 8);
+    pOut[3] = static_cast<uint8_t>(nMessage);
+    pOut[4] = static_cast<uint8_t>(nLength);
+    pOut[5] = static_cast<uint8_t>(nLength >> 8);
+    if (nLength > 0)
+    {
+        std::memcpy(pOut + 6, pPayload, nLength);
+    }
+
+    uint8_t ckA = 0;
+    uint8_t ckB = 0;
+    for (size_t i = 2; i < nFrame - 2; i++)
+    {
+        ckA += pOut[i];
+        ckB += ckA;
+    }
+    pOut[6 + nLength] = ckA;
+    pOut[7 + nLength] = ckB;
+    return nFrame;
+}
+
+bool Ubx::DecodeNavPvt(const uint8_t* pPayload, uint16_t nLength, UbxNavPvt& pvt)
+{
+    if (nLength < 92)
+    {
+        return false;
+    }
+    pvt.iTow       = le_u32(pPayload);
+    pvt.year       = le_u16(pPayload + 4);
+    pvt.month      = pPayload[6];
+    pvt.day        = pPayload[7];
+    pvt.hour       = pPayload[8];
+    pvt.minute     = pPayload[9];
+    pvt.second     = pPayload[10];
+    pvt.bDateValid = (pPayload[11] & 0x01) != 0;
+    pvt.bTimeValid = (pPayload[11] & 0x02) != 0;
+    pvt.fixType    = pPayload[20];
+    pvt.bFixOk     = (pPayload[21] & 0x01) != 0;
+    pvt.numSV      = pPayload[23];
+    pvt.lonE7      = le_i32(pPayload + 24);
+    pvt.latE7      = le_i32(pPayload + 28);
+    pvt.hMslMm     = le_i32(pPayload + 36);
+    pvt.gSpeedMm   = le_i32(pPayload + 60);
+    return true;
+}
+
+bool Ubx::DecodeNavTimeGps(const uint8_t* pPayload, uint16_t nLength, UbxNavTimeGps& timeGps)
+{
+    if (nLength < 16)
+    {
+        return false;
+    }
+    timeGps.iTow        = le_u32(pPayload);
+    timeGps.week        = static_cast<int16_t>(le_u16(pPayload + 8));
+    timeGps.leapS       = static_cast<int8_t>(pPayload[10]);
+    timeGps.bTowValid   = (pPayload[11] & 0x01) != 0;
+    timeGps.bWeekValid  = (pPayload[11] & 0x02) != 0;
+    timeGps.bLeapSValid = (pPayload[11] & 0x04) != 0;
+    return true;
+}
+
+size_t Ubx::DecodeNavSat(const uint8_t* pPayload, uint16_t nLength, UbxSat* pSats, size_t nMaxSats)
+{
+    if (nLength < 8)
+    {
+        return 0;
+    }
+    size_t nSats = std::min(static_cast<size_t>(pPayload[5]), static_cast<size_t>((nLength - 8) / 12));
+    nSats        = std::min(nSats, nMaxSats);
+    for (size_t i = 0; i < nSats; i++)
+    {
+        const uint8_t* p = pPayload + 8 + 12 * i;
+        pSats[i].gnssId  = p[0];
+        pSats[i].svId    = p[1];
+        pSats[i].cno     = p[2];
+        pSats[i].elev    = static_cast<int8_t>(p[3]);
+        pSats[i].azim    = static_cast<int16_t>(le_u16(p + 4));
+        pSats[i].bUsed   = (le_u32(p + 8) & 0x08) != 0;
+    }
+    return nSats;
+}
@@ -0,0 +1,134 @@
+/*
+ * UBX binary protocol for u-blox receivers
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+auto constexpr UBX_SYNC1       = 0xB5;
+auto constexpr UBX_SYNC2       = 0x62;
+auto constexpr UBX_MAX_PAYLOAD = 8 + 12 * 64; // NAV-SAT with 64 satellites, the largest message we decode
+auto constexpr UBX_BUFSIZE     = 2048;        // Frame queue, room for a full NAV-SAT and several NAV-PVTs
+
+// Message class and ID, high and low byte
+auto constexpr UBX_ACK_NAK = 0x0500;
+auto constexpr UBX_ACK_ACK = 0x0501;
+auto constexpr UBX_NAV_PVT     = 0x0107;
+auto constexpr UBX_NAV_TIMEGPS = 0x0120;
+auto constexpr UBX_NAV_SAT     = 0x0135;
+
+// NAV-PVT, the complete navigation solution for one epoch
+struct UbxNavPvt
+{
+    uint32_t iTow;    // GPS time of week, ms
+    uint16_t year;    // UTC
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    bool bDateValid;
+    bool bTimeValid;
+    uint8_t fixType;  // 0 none, 2 2D, 3 3D, ...
+    bool bFixOk;      // fix within the configured accuracy masks
+    uint8_t numSV;    // satellites used in the solution
+    int32_t lonE7;    // degrees * 1e7
+    int32_t latE7;    // degrees * 1e7
+    int32_t hMslMm;   // height above mean sea level, mm
+    int32_t gSpeedMm; // ground speed, mm/s
+};
+
+// NAV-TIMEGPS, GPS week and time of week and the GPS-UTC leap seconds
+struct UbxNavTimeGps
+{
+    uint32_t iTow;    // GPS time of week, ms
+    int16_t week;     // GPS week since 1980-01-06, not rolled over
+    int8_t leapS;     // GPS-UTC, s
+    bool bTowValid;
+    bool bWeekValid;
+    bool bLeapSValid; // leapS from the almanac rather than the firmware default
+};
+
+// One satellite of NAV-SAT
+struct UbxSat
+{
+    uint8_t gnssId; // 0 GPS, 1 SBAS, 2 Galileo, 3 BeiDou, 5 QZSS, 6 GLONASS
+    uint8_t svId;
+    uint8_t cno;    // carrier to noise, dBHz
+    int8_t elev;    // degrees
+    int16_t azim;   // degrees
+    bool bUsed;     // used in the navigation solution
+};
+
+// UbxFramer class
+//
+// Splits UBX frames out of the receiver byte stream, one byte at a time from the RX interrupt.
+// Bytes outside a frame are left for the NMEA path, which never sees the 0xB5 sync byte.  Frames
+// that pass the Fletcher checksum are queued whole for Pop() in the main loop; the caller keeps
+// the RX interrupt masked around Pop(), as for the NMEA buffer.  A frame that does not fit is
+// dropped and counted.
+//
+class UbxFramer
+{
+public:
+    UbxFramer();
+
+    bool Feed(uint8_t ch); // false when the byte is not part of a UBX frame
+    bool Pop(uint16_t& nMessage, uint8_t* pPayload, uint16_t& nLength);
+    void Reset();
+    uint32_t Dropped() const
+    {
+        return m_nDropped;
+    }
+    uint32_t BadChecksums() const
+    {
+        return m_nBadChecksums;
+    }
+
+private:
+    enum State : uint8_t
+    {
+        kIdle,
+        kSync2,
+        kHeader,
+        kPayload,
+        kChecksumA,
+        kChecksumB,
+    };
+
+    void put(uint8_t ch);
+
+    uint8_t m_buffer[UBX_BUFSIZE];
+    volatile size_t m_iHead; // published end of the last complete frame
+    volatile size_t m_iTail;
+    size_t m_iWrite;         // write position within the frame being received
+    State m_state;
+    uint8_t m_nHeaderBytes;
+    uint16_t m_nLength;
+    uint16_t m_nRemaining;
+    bool m_bSkip;            // frame too large for the space left, checked but not stored
+    uint8_t m_ckA;
+    uint8_t m_ckB;
+    uint8_t m_rxCkA;         // received first checksum byte
+    uint8_t m_header[4];
+    uint32_t m_nDropped;
+    uint32_t m_nBadChecksums;
+};
+
+// Ubx class
+//
+// Message encoding and payload decoding.
+//
+class Ubx
+{
+public:
+    static size_t Encode(uint16_t nMessage, const uint8_t* pPayload, uint16_t nLength, uint8_t* pOut, size_t nOutSize);
+    static bool DecodeNavPvt(const uint8_t* pPayload, uint16_t nLength, UbxNavPvt& pvt);
+    static bool DecodeNavTimeGps(const uint8_t* pPayload, uint16_t nLength, UbxNavTimeGps& timeGps);
+    static size_t DecodeNavSat(const uint8_t* pPayload, uint16_t nLength, UbxSat* pSats, size_t nMaxSats);
+};
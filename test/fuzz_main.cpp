@@ -0,0 +1,156 @@
+/*
+ * Stand-alone driver for the fuzz targets, for compilers without libFuzzer
+ *
+ * (c) 2026 Erik Tkal
+ *
+ * Notes:
+ *   1) Replays every corpus file, then runs -runs=N inputs mutated from them: bit flips, byte
+ *      changes, inserts, deletes and splices.  The seed is fixed, so a failure reproduces.
+ *   2) Takes the same "-runs=N <corpus dirs or files>" as libFuzzer, so one test command suits both.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* pData, size_t nSize);
+
+namespace
+{
+    constexpr size_t maxInputSize = 8192;
+
+    bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& vData)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+        vData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    void mutate(std::vector<uint8_t>& vData, const std::vector<std::vector<uint8_t>>& vCorpus, std::mt19937& rng)
+    {
+        const int nMutations = 1 + static_cast<int>(rng() % 8);
+        for (int n = 0; n < nMutations; n++)
+        {
+            const size_t nSize = vData.size();
+            const size_t iPos  = nSize == 0 ? 0 : rng() % nSize;
+            switch (rng() % 5)
+            {
+            case 0: // flip a bit
+                if (nSize != 0)
+                {
+                    vData[iPos] ^= static_cast<uint8_t>(1u << (rng() % 8));
+                }
+                break;
+            case 1: // replace a byte, favouring the characters that structure a sentence
+            {
+                static const char special[] = "$*,\r\n.0123456789ABCDEF\xb5\x62";
+                if (nSize != 0)
+                {
+                    vData[iPos] = (rng() % 2) ? static_cast<uint8_t>(special[rng() % (sizeof(special) - 1)]) : static_cast<uint8_t>(rng());
+                }
+                break;
+            }
+            case 2: // insert a byte
+                if (nSize < maxInputSize)
+                {
+                    vData.insert(vData.begin() + iPos, static_cast<uint8_t>(rng()));
+                }
+                break;
+            case 3: // delete a run
+                if (nSize != 0)
+                {
+                    const size_t nRun = std::min<size_t>(1 + rng() % 16, nSize - iPos);
+                    vData.erase(vData.begin() + iPos, vData.begin() + iPos + nRun);
+                }
+                break;
+            default: // splice in part of another input
+            {
+                const std::vector<uint8_t>& vOther = vCorpus[rng() % vCorpus.size()];
+                if (!vOther.empty() && nSize < maxInputSize)
+                {
+                    const size_t iFrom = rng() % vOther.size();
+                    const size_t nRun  = std::min<size_t>(1 + rng() % 64, vOther.size() - iFrom);
+                    vData.insert(vData.begin() + iPos, vOther.begin() + iFrom, vOther.begin() + iFrom + nRun);
+                }
+                break;
+            }
+            }
+        }
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    long nRuns = 0;
+    std::vector<std::vector<uint8_t>> vCorpus;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "-runs=", 6) == 0)
+        {
+            nRuns = strtol(argv[i] + 6, nullptr, 10);
+            continue;
+        }
+        if (argv[i][0] == '-')
+        {
+            continue; // other libFuzzer options mean nothing here
+        }
+
+        std::error_code ec;
+        std::vector<std::filesystem::path> vPaths;
+        if (std::filesystem::is_directory(argv[i], ec))
+        {
+            for (const auto& entry : std::filesystem::directory_iterator(argv[i]))
+            {
+                vPaths.push_back(entry.path());
+            }
+        }
+        else
+        {
+            vPaths.push_back(argv[i]);
+        }
+        std::sort(vPaths.begin(), vPaths.end()); // a fixed order keeps the mutations reproducible
+        for (const auto& path : vPaths)
+        {
+            std::vector<uint8_t> vData;
+            if (!readFile(path, vData))
+            {
+                printf("cannot read %s\n", path.string().c_str());
+                return 1;
+            }
+            vCorpus.push_back(std::move(vData));
+        }
+    }
+    if (vCorpus.empty())
+    {
+        printf("usage: %s [-runs=N] <corpus dirs or files>\n", argv[0]);
+        return 2;
+    }
+
+    for (const auto& vData : vCorpus)
+    {
+        LLVMFuzzerTestOneInput(vData.data(), vData.size());
+    }
+
+    std::mt19937 rng(1);
+    std::vector<uint8_t> vInput;
+    for (long nRun = 0; nRun < nRuns; nRun++)
+    {
+        vInput = vCorpus[rng() % vCorpus.size()];
+        mutate(vInput, vCorpus, rng);
+        LLVMFuzzerTestOneInput(vInput.data(), vInput.size());
+    }
+    printf("%u inputs replayed, %ld mutated\n", (unsigned int)vCorpus.size(), nRuns);
+    return 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Fuzz target for the NMEA and UBX parser
+ *
+ * (c) 2026 Erik Tkal
+ *
+ * Notes:
+ *   1) Bytes are split as the RX interrupt splits them: the UBX framer takes its frames first and
+ *      the rest is cut into lines on '\n', so the parser sees what it would see from the UART.
+ *   2) The first byte picks the epoch trigger, so every completion path is reached.
+ *   3) Built against libFuzzer with Clang, otherwise against the replay and mutation driver in
+ *      fuzz_main.cpp; both take "-runs=N <corpus dirs or files>".
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "gps_parser.h"
+#include "ubx.h"
+
+namespace
+{
+    constexpr size_t maxLineLength = 4096; // GPS_BUFSIZE; a longer unterminated line is dropped as noise
+    constexpr uint64_t lineUs      = 1000; // time taken by each line or frame
+
+    // Touch what the display would read, so the sanitizers see every field handed out
+    void gpsDataCB(void* pCtx, GPSData::Shared spGPSData)
+    {
+        size_t& nTotal = *static_cast<size_t*>(pCtx);
+        nTotal += spGPSData->strLatitude.size() + spGPSData->strLongitude.size() + spGPSData->strAltitude.size() +
+                  spGPSData->strSpeed.size() + spGPSData->strGPSTime.size() + spGPSData->strGPSDateRaw.size();
+        const SatTable& sats = spGPSData->Sats();
+        for (size_t i = 0; i < sats.Size(); i++)
+        {
+            nTotal += sats[i].m_el + sats[i].m_az + sats[i].m_rssi + (sats.IsUsed(i) ? 1 : 0);
+        }
+    }
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* pData, size_t nSize)
+{
+    if (nSize == 0)
+    {
+        return 0;
+    }
+
+    static const EpochTrigger triggers[] = {EpochTrigger::Quiet, EpochTrigger::Gga, EpochTrigger::Rmc};
+    size_t nTotal                        = 0;
+    GPSParser parser;
+    parser.SetEpochTrigger(triggers[pData[0] % 3]);
+    parser.SetGpsDataCallback(&nTotal, gpsDataCB);
+
+    UbxFramer framer;
+    static uint8_t aPayload[UBX_MAX_PAYLOAD];
+    uint16_t nMessage = 0;
+    uint16_t nLength  = 0;
+    uint64_t nNowUs   = 0;
+    std::string strLine;
+    for (size_t i = 1; i < nSize; i++)
+    {
+        if (!framer.Feed(pData[i]))
+        {
+            strLine += static_cast<char>(pData[i]);
+            if (pData[i] == '\n')
+            {
+                nNowUs += lineUs;
+                parser.ProcessSentence(strLine, nNowUs);
+                strLine.clear();
+            }
+            else if (strLine.size() >= maxLineLength)
+            {
+                strLine.clear();
+            }
+        }
+        while (framer.Pop(nMessage, aPayload, nLength))
+        {
+            nNowUs += lineUs;
+            parser.ProcessUbx(nMessage, aPayload, nLength, nNowUs);
+        }
+    }
+    parser.EndBurst(nNowUs + GPS_EPOCH_QUIET_US + 1);
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ * Golden image test for the GPS_TFT dashboard
+ *
+ * (c) 2026 Erik Tkal
+ *
+ * Notes:
+ *   1) Canned GPSData frames are drawn through GPS_TFT onto a HeadlessTFT and compared pixel for
+ *      pixel with the PPMs in test/golden.  A mismatch leaves <name>.actual.ppm in the working
+ *      directory for inspection.
+ *   2) After an intended change to the drawing, regenerate the images with
+ *      "golden_tft <golden dir> --update" and review them before committing.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "gps_tft.h"
+#include "headless_tft.h"
+
+namespace
+{
+    // The fix's UTC date must not predate the build date the test is compiled with
+    GPSData::Shared fixData()
+    {
+        auto spData           = std::make_shared<GPSData>();
+        spData->bHasPosition  = true;
+        spData->strLatitude   = " 42.3601N";
+        spData->strLongitude  = " 71.0589W";
+        spData->nLatitudeE7   = 423601000;
+        spData->nLongitudeE7  = -710589000;
+        spData->strAltitude   = "43.0m";
+        spData->strNumSats    = "Sat: 07";
+        spData->strMode3D     = "3D";
+        spData->strSpeed      = "2.4mph";
+        spData->strGPSTimeRaw = "123456";
+        spData->strGPSDateRaw = "150626";
+        spData->strGPSTime    = "12:34:56Z";
+        spData->nGPSTimeUs    = time_us_64();
+
+        SatTable& sats = spData->aSatTables[spData->iSatTable];
+        sats.Insert(SatInfo(2, 67, 45, 44), true);
+        sats.Insert(SatInfo(5, 32, 130, 38), true);
+        sats.Insert(SatInfo(12, 15, 210, 24), true);
+        sats.Insert(SatInfo(25, 48, 300, 41), true);
+        sats.Insert(SatInfo(29, 8, 330, 0), false);
+        sats.Insert(SatInfo(70, 55, 90, 35, GnssSystem::Glonass), true);
+        sats.Insert(SatInfo(11, 22, 170, 30, GnssSystem::Galileo), true);
+        sats.Insert(SatInfo(19, 40, 250, 33, GnssSystem::BeiDou), true);
+        return spData;
+    }
+
+    // Satellites in view but no position or time yet
+    GPSData::Shared noFixData()
+    {
+        auto spData        = std::make_shared<GPSData>();
+        spData->strNumSats = "Sat: 00";
+
+        SatTable& sats = spData->aSatTables[spData->iSatTable];
+        sats.Insert(SatInfo(5, 32, 130, 18), false);
+        sats.Insert(SatInfo(12, 15, 210, 0), false);
+        sats.Insert(SatInfo(25, 48, 300, 21), false);
+        return spData;
+    }
+
+    bool checkFrame(const HeadlessTFT& display, const std::string& strGoldenDir, const std::string& strName, bool bUpdate)
+    {
+        const std::string strGolden = strGoldenDir + "/" + strName + ".ppm";
+        if (bUpdate)
+        {
+            if (!display.WritePPM(strGolden))
+            {
+                printf("%s: cannot write %s\n", strName.c_str(), strGolden.c_str());
+                return false;
+            }
+            printf("%s: updated\n", strName.c_str());
+            return true;
+        }
+
+        std::vector<uint8_t> vGolden;
+        if (!display.ReadPPM(strGolden, vGolden))
+        {
+            printf("%s: cannot read %s\n", strName.c_str(), strGolden.c_str());
+            return false;
+        }
+        const uint32_t nDiffs = display.CountDifferences(vGolden);
+        if (nDiffs != 0)
+        {
+            display.WritePPM(strName + ".actual.ppm");
+            printf("%s: %u pixels differ, see %s.actual.ppm\n", strName.c_str(), (unsigned int)nDiffs, strName.c_str());
+            return false;
+        }
+        printf("%s: ok\n", strName.c_str());
+        return true;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <golden dir> [--update]\n", argv[0]);
+        return 2;
+    }
+    const std::string strGoldenDir = argv[1];
+    const bool bUpdate             = argc > 2 && strcmp(argv[2], "--update") == 0;
+
+    auto spDisplay = std::make_shared<HeadlessTFT>(320, 480, R270DEG);
+    auto spGPS     = std::make_shared<GPS>(uart0);
+    auto spTimeMgr = std::make_shared<TimeMgr>("America/New_York");
+    GPS_TFT gpsTFT(spDisplay, spGPS, nullptr, spTimeMgr);
+
+    bool bOk = true;
+    gpsTFT.Initialize();
+    bOk &= checkFrame(*spDisplay, strGoldenDir, "waiting", bUpdate);
+
+    HostAdvanceUs(1000000);
+    gpsTFT.UpdateUI(fixData());
+    bOk &= checkFrame(*spDisplay, strGoldenDir, "fix", bUpdate);
+
+    HostAdvanceUs(1000000);
+    gpsTFT.UpdateUI(noFixData());
+    bOk &= checkFrame(*spDisplay, strGoldenDir, "no_fix", bUpdate);
+
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+/*
+ * Host stand-in for the Pico SDK's hardware/adc.h
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+static inline void adc_init()
+{
+}
+static inline void adc_gpio_init(unsigned int)
+{
+}
+static inline void adc_select_input(unsigned int)
+{
+}
+static inline uint16_t adc_read()
+{
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Host stand-in for the Pico SDK's hardware/gpio.h; pins read low and writes are dropped
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define GPIO_OUT true
+#define GPIO_IN  false
+
+enum gpio_function
+{
+    GPIO_FUNC_SPI,
+    GPIO_FUNC_UART,
+    GPIO_FUNC_PWM,
+    GPIO_FUNC_SIO,
+};
+
+enum gpio_irq_level
+{
+    GPIO_IRQ_LEVEL_LOW  = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL  = 0x4u,
+    GPIO_IRQ_EDGE_RISE  = 0x8u,
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+#define IO_IRQ_BANK0 13
+
+static inline void gpio_init(uint)
+{
+}
+static inline void gpio_deinit(uint)
+{
+}
+static inline void gpio_set_dir(uint, bool)
+{
+}
+static inline void gpio_put(uint, bool)
+{
+}
+static inline bool gpio_get(uint)
+{
+    return false;
+}
+static inline void gpio_pull_up(uint)
+{
+}
+static inline void gpio_pull_down(uint)
+{
+}
+static inline void gpio_disable_pulls(uint)
+{
+}
+static inline void gpio_set_function(uint, enum gpio_function)
+{
+}
+static inline void gpio_set_irq_enabled(uint, uint32_t, bool)
+{
+}
+static inline void gpio_set_irq_enabled_with_callback(uint, uint32_t, bool, gpio_irq_callback_t)
+{
+}
+static inline void gpio_add_raw_irq_handler(uint, void (*)(void))
+{
+}
+static inline uint32_t gpio_get_irq_event_mask(uint)
+{
+    return 0;
+}
+static inline void gpio_acknowledge_irq(uint, uint32_t)
+{
+}
@@ -0,0 +1,17 @@
+/*
+ * Host stand-in for the Pico SDK's hardware/irq.h
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+typedef void (*irq_handler_t)(void);
+
+static inline void irq_set_exclusive_handler(unsigned int, irq_handler_t)
+{
+}
+static inline void irq_set_enabled(unsigned int, bool)
+{
+}
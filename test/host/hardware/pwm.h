@@ -0,0 +1,51 @@
+/*
+ * Host stand-in for the Pico SDK's hardware/pwm.h; the backlight level is dropped
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t csr;
+    uint32_t div;
+    uint32_t top;
+} pwm_config;
+
+static inline unsigned int pwm_gpio_to_slice_num(unsigned int)
+{
+    return 0;
+}
+static inline unsigned int pwm_gpio_to_channel(unsigned int)
+{
+    return 0;
+}
+static inline pwm_config pwm_get_default_config()
+{
+    return pwm_config{};
+}
+static inline void pwm_config_set_wrap(pwm_config*, uint16_t)
+{
+}
+static inline void pwm_config_set_clkdiv(pwm_config*, float)
+{
+}
+static inline void pwm_init(unsigned int, pwm_config*, bool)
+{
+}
+static inline void pwm_set_wrap(unsigned int, uint16_t)
+{
+}
+static inline void pwm_set_chan_level(unsigned int, unsigned int, uint16_t)
+{
+}
+static inline void pwm_set_gpio_level(unsigned int, uint16_t)
+{
+}
+static inline void pwm_set_enabled(unsigned int, bool)
+{
+}
@@ -0,0 +1,69 @@
+/*
+ * Host stand-in for the Pico SDK's hardware/spi.h; nothing is attached, so writes vanish and reads return zeroes
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct spi_inst spi_inst_t;
+extern spi_inst_t* spi0;
+extern spi_inst_t* spi1;
+
+typedef enum
+{
+    SPI_CPHA_0 = 0,
+    SPI_CPHA_1 = 1,
+} spi_cpha_t;
+typedef enum
+{
+    SPI_CPOL_0 = 0,
+    SPI_CPOL_1 = 1,
+} spi_cpol_t;
+typedef enum
+{
+    SPI_LSB_FIRST = 0,
+    SPI_MSB_FIRST = 1,
+} spi_order_t;
+
+// The baud rate reads back as zero, which the display treats as "too slow to sync to V-blank"
+static inline unsigned int spi_init(spi_inst_t*, unsigned int baudrate)
+{
+    return baudrate;
+}
+static inline void spi_deinit(spi_inst_t*)
+{
+}
+static inline unsigned int spi_set_baudrate(spi_inst_t*, unsigned int baudrate)
+{
+    return baudrate;
+}
+static inline unsigned int spi_get_baudrate(const spi_inst_t*)
+{
+    return 0;
+}
+static inline void spi_set_format(spi_inst_t*, unsigned int, spi_cpol_t, spi_cpha_t, spi_order_t)
+{
+}
+static inline int spi_write_blocking(spi_inst_t*, const uint8_t*, size_t len)
+{
+    return static_cast<int>(len);
+}
+static inline int spi_read_blocking(spi_inst_t*, uint8_t, uint8_t* dst, size_t len)
+{
+    memset(dst, 0, len);
+    return static_cast<int>(len);
+}
+static inline bool spi_is_writable(const spi_inst_t*)
+{
+    return true;
+}
+static inline bool spi_is_busy(const spi_inst_t*)
+{
+    return false;
+}
@@ -0,0 +1,10 @@
+/*
+ * Host stand-in for the Pico SDK's hardware/sync.h
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include "pico/stdlib.h"
@@ -0,0 +1,78 @@
+/*
+ * Host stand-in for the Pico SDK's hardware/uart.h; nothing is ever received
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hardware/irq.h"
+
+typedef struct uart_inst uart_inst_t;
+extern uart_inst_t* uart0;
+extern uart_inst_t* uart1;
+
+#define UART0_IRQ 20
+#define UART1_IRQ 21
+
+typedef enum
+{
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD,
+} uart_parity_t;
+
+static inline unsigned int uart_init(uart_inst_t*, unsigned int baudrate)
+{
+    return baudrate;
+}
+static inline void uart_deinit(uart_inst_t*)
+{
+}
+static inline unsigned int uart_set_baudrate(uart_inst_t*, unsigned int baudrate)
+{
+    return baudrate;
+}
+static inline void uart_set_format(uart_inst_t*, unsigned int, unsigned int, uart_parity_t)
+{
+}
+static inline void uart_set_hw_flow(uart_inst_t*, bool, bool)
+{
+}
+static inline void uart_set_fifo_enabled(uart_inst_t*, bool)
+{
+}
+static inline void uart_set_irq_enables(uart_inst_t*, bool, bool)
+{
+}
+static inline void uart_set_irqs_enabled(uart_inst_t*, bool, bool)
+{
+}
+static inline unsigned int uart_get_index(const uart_inst_t* uart)
+{
+    return uart == uart1 ? 1 : 0;
+}
+static inline bool uart_is_readable(uart_inst_t*)
+{
+    return false;
+}
+static inline char uart_getc(uart_inst_t*)
+{
+    return 0;
+}
+static inline void uart_putc(uart_inst_t*, char)
+{
+}
+static inline void uart_puts(uart_inst_t*, const char*)
+{
+}
+static inline void uart_write_blocking(uart_inst_t*, const uint8_t*, size_t)
+{
+}
+static inline void uart_tx_wait_blocking(uart_inst_t*)
+{
+}
@@ -0,0 +1,78 @@
+/*
+ * Host clock behind the Pico SDK stand-ins
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#include <sys/time.h>
+
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/uart.h"
+#include "led.h"
+
+// The instances are only compared and passed through, never dereferenced
+uart_inst_t* uart0 = reinterpret_cast<uart_inst_t*>(0x40034000);
+uart_inst_t* uart1 = reinterpret_cast<uart_inst_t*>(0x40038000);
+spi_inst_t* spi0   = reinterpret_cast<spi_inst_t*>(0x4003c000);
+spi_inst_t* spi1   = reinterpret_cast<spi_inst_t*>(0x40040000);
+
+static uint64_t sg_nTimeUs    = 0;
+static uint64_t sg_nWallSetUs = 0; // microsecond count when the wall clock was last set
+static time_t sg_nWallSetSec  = 0;
+
+static uint64_t wallClockUs()
+{
+    return static_cast<uint64_t>(sg_nWallSetSec) * 1000000 + (sg_nTimeUs - sg_nWallSetUs);
+}
+
+uint64_t HostTimeUs()
+{
+    return sg_nTimeUs;
+}
+
+void HostAdvanceUs(uint64_t nUs)
+{
+    sg_nTimeUs += nUs;
+}
+
+void HostSetWallClock(time_t nEpochSec)
+{
+    sg_nWallSetSec = nEpochSec;
+    sg_nWallSetUs  = sg_nTimeUs;
+}
+
+extern "C" time_t __wrap_time(time_t* pTime)
+{
+    const time_t nNow = static_cast<time_t>(wallClockUs() / 1000000);
+    if (pTime != nullptr)
+    {
+        *pTime = nNow;
+    }
+    return nNow;
+}
+
+extern "C" int __wrap_gettimeofday(struct timeval* pTv, void*)
+{
+    const uint64_t nNowUs = wallClockUs();
+    pTv->tv_sec           = static_cast<time_t>(nNowUs / 1000000);
+    pTv->tv_usec          = static_cast<suseconds_t>(nNowUs % 1000000);
+    return 0;
+}
+
+extern "C" int __wrap_settimeofday(const struct timeval* pTv, const struct timezone*)
+{
+    sg_nWallSetSec = pTv->tv_sec;
+    sg_nWallSetUs  = sg_nTimeUs - static_cast<uint64_t>(pTv->tv_usec);
+    return 0;
+}
+
+// The display tests run without an LED; GPS_TFT only calls these when given one
+void LED::Blink_ms(uint, uint32_t)
+{
+}
+
+LED::~LED()
+{
+}
@@ -0,0 +1,22 @@
+/*
+ * Host clock behind the Pico SDK stand-ins
+ *
+ * (c) 2026 Erik Tkal
+ *
+ * Notes:
+ *   1) The microsecond counter starts at zero and moves only when the code sleeps or a test
+ *      advances it, so a run draws the same frames every time.
+ *   2) The wall clock is linked over time(), gettimeofday() and settimeofday() with
+ *      -Wl,--wrap, so setting the time from GPS never reaches the host's own clock.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t HostTimeUs();
+void HostAdvanceUs(uint64_t nUs);
+
+// Sets the wall clock to nEpochSec at the current microsecond count
+void HostSetWallClock(time_t nEpochSec);
@@ -0,0 +1,31 @@
+/*
+ * Host stand-in for the Pico SDK's pico/aon_timer.h; the host wall clock lives in host_sdk.cpp
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <time.h>
+
+static inline bool aon_timer_start(const struct timespec*)
+{
+    return true;
+}
+static inline bool aon_timer_start_with_timeofday()
+{
+    return true;
+}
+static inline bool aon_timer_set_time(const struct timespec*)
+{
+    return true;
+}
+static inline bool aon_timer_get_time(struct timespec*)
+{
+    return false;
+}
+static inline bool aon_timer_is_running()
+{
+    return true;
+}
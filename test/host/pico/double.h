@@ -0,0 +1,8 @@
+/*
+ * Host stand-in for the Pico SDK's pico/double.h; the host's own double support is used
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for the Pico SDK's pico/multicore.h; core 1 is never started
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+static inline void multicore_launch_core1(void (*)(void))
+{
+}
@@ -0,0 +1,127 @@
+/*
+ * Host stand-in for the Pico SDK's pico/stdlib.h, enough to build the sources off target
+ *
+ * (c) 2026 Erik Tkal
+ *
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "host_sdk.h"
+#include "hardware/gpio.h"
+#include "hardware/uart.h"
+
+typedef uint64_t absolute_time_t;
+
+#define PICO_OK            0
+#define PICO_ERROR_GENERIC -1
+#define PICO_ERROR_TIMEOUT -2
+
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+#define __not_in_flash_func(f)   f
+#define __time_critical_func(f)  f
+
+// Time comes from the host clock in host_sdk.cpp, which only moves when sleeping or when a test advances it
+static inline uint64_t time_us_64()
+{
+    return HostTimeUs();
+}
+static inline uint32_t time_us_32()
+{
+    return static_cast<uint32_t>(HostTimeUs());
+}
+static inline void sleep_us(uint64_t us)
+{
+    HostAdvanceUs(us);
+}
+static inline void sleep_ms(uint32_t ms)
+{
+    HostAdvanceUs(static_cast<uint64_t>(ms) * 1000);
+}
+static inline void busy_wait_us(uint64_t us)
+{
+    HostAdvanceUs(us);
+}
+static inline void tight_loop_contents()
+{
+}
+static inline absolute_time_t get_absolute_time()
+{
+    return HostTimeUs();
+}
+static inline absolute_time_t make_timeout_time_us(uint64_t us)
+{
+    return HostTimeUs() + us;
+}
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+    return HostTimeUs() + static_cast<uint64_t>(ms) * 1000;
+}
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+    return static_cast<int64_t>(to - from);
+}
+static inline uint64_t to_us_since_boot(absolute_time_t t)
+{
+    return t;
+}
+static inline bool time_reached(absolute_time_t t)
+{
+    return HostTimeUs() >= t;
+}
+
+typedef struct repeating_timer
+{
+    void* user_data;
+} repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t* pTimer);
+
+static inline bool add_repeating_timer_ms(int32_t, repeating_timer_callback_t, void* pUserData, repeating_timer_t* pTimer)
+{
+    pTimer->user_data = pUserData;
+    return true;
+}
+static inline bool cancel_repeating_timer(repeating_timer_t*)
+{
+    return true;
+}
+
+static inline bool stdio_init_all()
+{
+    return true;
+}
+static inline bool stdio_usb_connected()
+{
+    return false;
+}
+static inline int getchar_timeout_us(uint32_t)
+{
+    return PICO_ERROR_TIMEOUT;
+}
+
+static inline uint32_t save_and_disable_interrupts()
+{
+    return 0;
+}
+static inline void restore_interrupts(uint32_t)
+{
+}
+static inline void __dmb()
+{
+}
+static inline void __wfe()
+{
+}
+static inline void __sev()
+{
+}